@@ -0,0 +1,7 @@
+
+BENCH_ARGS =
+
+bench: all
+	$(PHP_EXECUTABLE) -n -d extension=$(phplibdir)/icu4c.so $(srcdir)/bench/bench.php $(BENCH_ARGS)
+
+.PHONY: bench
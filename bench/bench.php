@@ -0,0 +1,241 @@
+<?php
+
+// Benchmark suite for the icu4c extension
+//
+// Usage: php -d extension=modules/icu4c.so bench/bench.php [options]
+//   --size=BYTES        Approximate size of each corpus (default 1048576)
+//   --iterations=N      Timed repetitions per benchmark; the median is reported (default 5)
+//   --only=NAME[,NAME]  Run only these corpora
+//   --output=FILE       Write the JSON report to FILE instead of stdout
+//   --compare=FILE      Print the change against an earlier JSON report to stderr
+//   --threads=N[,N]     Also time full segmentation with icu4c.parallel_threads set to each N
+//
+// Corpora are generated from a fixed seed, so reports from different
+// commits (or ICU versions) measure identical input.
+
+const BENCH_SEED = 20240601;
+
+$options = getopt('', ['size:', 'iterations:', 'only:', 'output:', 'compare:', 'threads:']);
+$size = (int)($options['size'] ?? 1048576);
+$iterations = max(1, (int)($options['iterations'] ?? 5));
+$only = isset($options['only']) ? explode(',', $options['only']) : null;
+$threads = isset($options['threads']) ? array_map('intval', explode(',', $options['threads'])) : [];
+
+if (!extension_loaded('icu4c')) {
+    fwrite(STDERR, "The icu4c extension is not loaded\n");
+    exit(1);
+}
+
+// Building blocks of each corpus; each entry is picked at random until
+// the corpus reaches the requested size
+$corpora = [
+    'ascii' => [
+        'the ', 'quick ', 'brown ', 'fox ', 'jumps ', 'over ', 'lazy ', 'dog', '. ', ', ', "\n", "\r\n", '2024 ',
+    ],
+    'cjk' => [
+        '漢字', '東京都', '葛飾区', 'ひらがな', 'カタカナ', '中文', '한국어', '。', '、', 'ｱｲｳ', '　',
+    ],
+    'emoji_zwj' => [
+        '👨‍👩‍👧‍👦', '👩🏽‍💻', '🏳️‍🌈', '🇯🇵', '🇺🇸', '❤️', '👍🏿', '🧑‍🤝‍🧑', ' ',
+    ],
+    'combining' => [
+        'क्षत्रिय', 'स्त्री', 'हिन्दी ', 'ภาษาไทย', 'สวัสดี ', 'กำลัง', "e\u{0301}", "a\u{0308}\u{0301}", 'ழ்', ' ',
+    ],
+    'mixed' => [
+        'Hello ', 'café ', '葛󠄁飾区', '👨‍👩‍👧', 'ภาษาไทย', 'naïve ', "\r\n", 'Ελληνικά ', 'Русский ', '🇯🇵', '田中 ',
+    ],
+];
+
+// Generate a corpus of about $size bytes from its pieces
+function bench_corpus(array $pieces, int $size): string
+{
+    mt_srand(BENCH_SEED);
+    $parts = [];
+    $length = 0;
+    $count = count($pieces);
+
+    while ($length < $size) {
+        $piece = $pieces[mt_rand(0, $count - 1)];
+        $parts[] = $piece;
+        $length += strlen($piece);
+    }
+
+    return implode('', $parts);
+}
+
+// Median of the wall time (ns) of $iterations calls to $fn
+function bench_time(callable $fn, int $iterations): float
+{
+    $fn();  // Warm-up (break iterator pool, width table pages)
+
+    $times = [];
+    for ($i = 0; $i < $iterations; $i++) {
+        $start = hrtime(true);
+        $fn();
+        $times[] = hrtime(true) - $start;
+    }
+
+    sort($times);
+    return (float)$times[intdiv(count($times), 2)];
+}
+
+// Memory held by the result of $fn, and peak memory while computing it
+function bench_memory(callable $fn): array
+{
+    if (function_exists('memory_reset_peak_usage')) {
+        memory_reset_peak_usage();
+    }
+    $before = memory_get_usage();
+    $peak_before = memory_get_peak_usage();
+
+    $result = $fn();
+
+    $retained = memory_get_usage() - $before;
+    $peak = memory_get_peak_usage() - (function_exists('memory_reset_peak_usage') ? $before : $peak_before);
+    unset($result);
+
+    return [max(0, $retained), max(0, $peak)];
+}
+
+// Benchmarks: each returns the value whose memory is measured
+$benchmarks = [
+    // Construction only: segmentation is lazy, so this is the cost of the first cluster
+    'icu4c_iter' => function (string $text) {
+        $iter = icu4c_iter($text);
+        $iter->valid();
+        return $iter;
+    },
+    'foreach' => function (string $text) {
+        $iter = icu4c_iter($text);
+        foreach ($iter as $cluster) {
+        }
+        return $iter;
+    },
+    'foreach_offsets' => function (string $text) {
+        $iter = icu4c_iter($text, ICU4C_ITER_OFFSETS);
+        foreach ($iter as $offsets) {
+        }
+        return $iter;
+    },
+    'count' => function (string $text) {
+        $iter = icu4c_iter($text);
+        count($iter);
+        return $iter;
+    },
+    'icu4c_graphemes' => function (string $text) {
+        return icu4c_graphemes($text);
+    },
+    'icu4c_eaw_width' => function (string $text, array $clusters) {
+        $width = 0;
+        foreach ($clusters as $cluster) {
+            $width += icu4c_eaw_width($cluster);
+        }
+        return $width;
+    },
+    'icu4c_str_width' => function (string $text) {
+        return icu4c_str_width($text);
+    },
+];
+
+$report = [
+    'php_version' => PHP_VERSION,
+    'extension_version' => phpversion('icu4c'),
+    'icu_version' => defined('ICU4C_ICU_VERSION') ? ICU4C_ICU_VERSION : null,
+    'unicode_version' => defined('ICU4C_UNICODE_VERSION') ? ICU4C_UNICODE_VERSION : null,
+    'commit' => trim((string)@shell_exec('git -C ' . escapeshellarg(dirname(__DIR__)) . ' rev-parse --short HEAD 2>/dev/null')) ?: null,
+    'size' => $size,
+    'iterations' => $iterations,
+    'seed' => BENCH_SEED,
+    'results' => [],
+    'scaling' => [],
+];
+
+foreach ($corpora as $corpus_name => $pieces) {
+    if ($only !== null && !in_array($corpus_name, $only, true)) {
+        continue;
+    }
+
+    $text = bench_corpus($pieces, $size);
+    $bytes = strlen($text);
+    $clusters = icu4c_graphemes($text);
+    $cluster_count = count($clusters);
+
+    foreach ($benchmarks as $bench_name => $bench) {
+        $call = fn() => $bench($text, $clusters);
+        $ns = bench_time($call, $iterations);
+        [$retained, $peak] = bench_memory($call);
+
+        // Construction alone does not segment the text, so rates are per call
+        $units = $bench_name === 'icu4c_iter' ? 1 : $cluster_count;
+
+        $report['results'][] = [
+            'corpus' => $corpus_name,
+            'benchmark' => $bench_name,
+            'bytes' => $bytes,
+            'clusters' => $cluster_count,
+            'median_ns' => $ns,
+            'clusters_per_sec' => $units / ($ns / 1e9),
+            'bytes_per_sec' => $bench_name === 'icu4c_iter' ? null : $bytes / ($ns / 1e9),
+            'retained_bytes' => $retained,
+            'peak_bytes' => $peak,
+        ];
+
+        fprintf(STDERR, "%-10s %-16s %10.2f ms %12.0f clusters/s %10d B retained\n",
+            $corpus_name, $bench_name, $ns / 1e6, $units / ($ns / 1e9), $retained);
+    }
+
+    // Full segmentation by thread count; the whole corpus is one text, so
+    // every run takes the parallel path once the corpus passes the minimum size
+    foreach ($threads as $thread_count) {
+        ini_set('icu4c.parallel_threads', (string)$thread_count);
+        ini_set('icu4c.parallel_min_size', '65536');
+
+        foreach (['icu4c_graphemes', 'count'] as $bench_name) {
+            $ns = bench_time(fn() => $benchmarks[$bench_name]($text, $clusters), $iterations);
+
+            $report['scaling'][] = [
+                'corpus' => $corpus_name,
+                'benchmark' => $bench_name,
+                'threads' => $thread_count,
+                'median_ns' => $ns,
+                'bytes_per_sec' => $bytes / ($ns / 1e9),
+            ];
+
+            fprintf(STDERR, "%-10s %-16s %2d threads %10.2f ms %10.1f MB/s\n",
+                $corpus_name, $bench_name, $thread_count, $ns / 1e6, $bytes / ($ns / 1e9) / 1e6);
+        }
+    }
+
+    ini_restore('icu4c.parallel_threads');
+    ini_restore('icu4c.parallel_min_size');
+}
+
+$json = json_encode($report, JSON_PRETTY_PRINT | JSON_UNESCAPED_SLASHES) . "\n";
+
+if (isset($options['output'])) {
+    file_put_contents($options['output'], $json);
+} else {
+    echo $json;
+}
+
+// Change in median time against an earlier report (negative is faster)
+if (isset($options['compare'])) {
+    $baseline = json_decode((string)file_get_contents($options['compare']), true);
+    $previous = [];
+
+    foreach ($baseline['results'] ?? [] as $result) {
+        $previous[$result['corpus'] . '/' . $result['benchmark']] = $result['median_ns'];
+    }
+
+    fprintf(STDERR, "\nCompared with %s (%s):\n", $options['compare'], $baseline['commit'] ?? 'unknown commit');
+    if (($baseline['icu_version'] ?? null) !== $report['icu_version']) {
+        fprintf(STDERR, "ICU4C version changed: %s -> %s\n",
+            $baseline['icu_version'] ?? 'unknown', $report['icu_version'] ?? 'none');
+    }
+    foreach ($report['results'] as $result) {
+        $key = $result['corpus'] . '/' . $result['benchmark'];
+        if (isset($previous[$key]) && $previous[$key] > 0) {
+            fprintf(STDERR, "%-28s %+7.1f%%\n", $key, ($result['median_ns'] / $previous[$key] - 1) * 100);
+        }
+    }
+}
@@ -47,6 +47,14 @@ if test "$PHP_ICU4C" != "no"; then
     AC_MSG_RESULT(yes)
   ])
   
+  dnl Native threads for icu4c.parallel_threads
+  PHP_CHECK_LIBRARY(pthread, pthread_create, [
+    PHP_ADD_LIBRARY(pthread, 1, ICU4C_SHARED_LIBADD)
+    AC_DEFINE(HAVE_ICU4C_THREADS, 1, [Have native threads for parallel segmentation])
+  ])
+  
   PHP_SUBST(ICU4C_SHARED_LIBADD)
-  PHP_NEW_EXTENSION(icu4c, icu4c.c icu4c_iterator.c, $ext_shared)
+  PHP_NEW_EXTENSION(icu4c, icu4c.c icu4c_iterator.c icu4c_width.c icu4c_stream.c icu4c_cache.c icu4c_parallel.c, $ext_shared)
+  PHP_ADD_EXTENSION_DEP(icu4c, spl)
+  PHP_ADD_MAKEFILE_FRAGMENT
 fi
\ No newline at end of file
@@ -7,52 +7,92 @@
 #include "ext/standard/info.h"
 #include "php_icu4c.h"
 
-// Global class entry
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+ZEND_DECLARE_MODULE_GLOBALS(icu4c)
+
+// Global class entries
 zend_class_entry *icu4c_iterator_ce;
+zend_class_entry *icu4c_stream_iterator_ce;
 
 // icu4c_iter function implementation
 PHP_FUNCTION(icu4c_iter)
 {
     zend_string *text;
+    zend_long flags = 0;
+    zend_long mode = ICU4C_BREAK_GRAPHEME;
+    zend_string *locale = NULL;
     
-    ZEND_PARSE_PARAMETERS_START(1, 1)
+    ZEND_PARSE_PARAMETERS_START(1, 4)
         Z_PARAM_STR(text)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(flags)
+        Z_PARAM_LONG(mode)
+        Z_PARAM_STR_OR_NULL(locale)
     ZEND_PARSE_PARAMETERS_END();
     
+    if (!icu4c_iterator_check_args(flags, mode, 2)) {
+        RETURN_THROWS();
+    }
+    
     // Create new ICU4CIterator object
     object_init_ex(return_value, icu4c_iterator_ce);
     
-    // Get the object structure
-    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(return_value));
+    // Initialize the iterator; boundaries are computed on demand
+    icu4c_iterator_setup(icu4c_iterator_from_obj(Z_OBJ_P(return_value)), text, flags, mode, locale);
+}
+
+// icu4c_iter_stream function implementation
+PHP_FUNCTION(icu4c_iter_stream)
+{
+    zval *zstream;
+    zend_long flags = 0;
+    zend_long chunk_size = ICU4C_STREAM_CHUNK_SIZE;
+    php_stream *stream;
     
-    // Initialize the iterator
-    obj->text = zend_string_copy(text);
-    obj->current_pos = 0;
-    obj->break_iter = NULL;
-    obj->utext = NULL;
-    obj->cluster_boundaries = NULL;
+    ZEND_PARSE_PARAMETERS_START(1, 3)
+        Z_PARAM_RESOURCE(zstream)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(flags)
+        Z_PARAM_LONG(chunk_size)
+    ZEND_PARSE_PARAMETERS_END();
     
-#ifdef HAVE_ICU4C
-    // Count grapheme clusters and build boundary array
-    obj->total_clusters = icu4c_count_grapheme_clusters(ZSTR_VAL(text), ZSTR_LEN(text), &obj->cluster_boundaries);
+    php_stream_from_zval(stream, zstream);
     
-    if (obj->total_clusters == 0) {
-        // Handle error case
-        obj->total_clusters = 0;
+    if (!icu4c_stream_iterator_check_args(flags, chunk_size, 2)) {
+        RETURN_THROWS();
     }
-#else
-    // Fallback: count UTF-8 characters
-    obj->total_clusters = 0;
-    const char *ptr = ZSTR_VAL(text);
-    const char *end = ptr + ZSTR_LEN(text);
-    
-    while (ptr < end) {
-        if ((*ptr & 0xC0) != 0x80) {
-            obj->total_clusters++;
-        }
-        ptr++;
+    
+    // Create new ICU4CStreamIterator object; nothing is read yet
+    object_init_ex(return_value, icu4c_stream_iterator_ce);
+    icu4c_stream_iterator_setup(icu4c_stream_iterator_from_obj(Z_OBJ_P(return_value)), zstream, flags, chunk_size);
+}
+
+// icu4c_iter_file function implementation
+PHP_FUNCTION(icu4c_iter_file)
+{
+    zend_string *filename;
+    zend_long flags = 0;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_PATH_STR(filename)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(flags)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    if (!icu4c_stream_iterator_check_args(flags, ICU4C_STREAM_CHUNK_SIZE, 2)) {
+        RETURN_THROWS();
+    }
+    
+    // Create new ICU4CStreamIterator object over a mapping of the file
+    object_init_ex(return_value, icu4c_stream_iterator_ce);
+    
+    if (!icu4c_stream_iterator_open_file(icu4c_stream_iterator_from_obj(Z_OBJ_P(return_value)), filename, flags)) {
+        zval_ptr_dtor(return_value);
+        RETURN_FALSE;
     }
-#endif
 }
 
 // icu4c_eaw_width function implementation
@@ -72,19 +112,15 @@ PHP_FUNCTION(icu4c_eaw_width)
     }
     
 #ifdef HAVE_ICU4C
-    // Get first Unicode codepoint from string
-    UChar32 codepoint = icu4c_get_first_codepoint(ZSTR_VAL(input), ZSTR_LEN(input));
+    // Width of the first grapheme cluster, so that combining marks, emoji
+    // sequences and flags count as a terminal shows them
+    int width = icu4c_first_cluster_width(ZSTR_VAL(input), ZSTR_LEN(input),
+        locale && icu4c_is_east_asian_locale(ZSTR_VAL(locale)));
     
-    if (codepoint < 0) {
+    if (width < 0) {
         RETURN_FALSE;
     }
     
-    // Get East Asian Width property
-    UEastAsianWidth eaw = (UEastAsianWidth)u_getIntPropertyValue(codepoint, UCHAR_EAST_ASIAN_WIDTH);
-    
-    // Calculate display width
-    int width = icu4c_calculate_display_width(eaw, locale);
-    
     RETURN_LONG(width);
 #else
     // Fallback: return 1 for single-byte, 2 for multi-byte
@@ -97,65 +133,616 @@ PHP_FUNCTION(icu4c_eaw_width)
 #endif
 }
 
+// icu4c_graphemes function implementation
+PHP_FUNCTION(icu4c_graphemes)
+{
+    zend_string *text;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(text)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    if (ZSTR_LEN(text) > INT32_MAX) {
+        zend_argument_value_error(1, "must not be longer than 2 GB");
+        RETURN_THROWS();
+    }
+    
+    if (ZSTR_LEN(text) == 0) {
+        RETURN_EMPTY_ARRAY();
+    }
+    
+    const char *str = ZSTR_VAL(text);
+    int32_t *boundaries;
+    size_t count = icu4c_count_grapheme_clusters(str, ZSTR_LEN(text), &boundaries);
+    
+    if (count == 0) {
+        // ICU4C could not be opened; an empty array would look like empty text
+        php_error_docref(NULL, E_WARNING, "ICU4C could not segment the text");
+        RETURN_FALSE;
+    }
+    
+    // Build a pre-sized packed array straight from the boundary array
+    array_init_size(return_value, (uint32_t)count);
+    zend_hash_real_init_packed(Z_ARRVAL_P(return_value));
+    
+    ZEND_HASH_FILL_PACKED(Z_ARRVAL_P(return_value)) {
+        for (size_t i = 0; i < count; i++) {
+            int32_t start = boundaries[i];
+            int32_t len = boundaries[i + 1] - start;
+            
+            if (len == 1) {
+                ZEND_HASH_FILL_SET_INTERNED_STR(ZSTR_CHAR((zend_uchar)str[start]));
+            } else {
+                ZEND_HASH_FILL_SET_STR(zend_string_init(str + start, len, 0));
+            }
+            ZEND_HASH_FILL_NEXT();
+        }
+    } ZEND_HASH_FILL_END();
+    
+    efree(boundaries);
+}
+
+// icu4c_grapheme_len function implementation
+PHP_FUNCTION(icu4c_grapheme_len)
+{
+    zend_string *text;
+    zend_long limit = 0;
+    bool limit_is_null = true;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_STR(text)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG_OR_NULL(limit, limit_is_null)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    if (ZSTR_LEN(text) > INT32_MAX) {
+        zend_argument_value_error(1, "must not be longer than 2 GB");
+        RETURN_THROWS();
+    }
+    
+    if (!limit_is_null && limit < 0) {
+        zend_argument_value_error(2, "must be greater than or equal to 0");
+        RETURN_THROWS();
+    }
+    
+    // With a limit, counting stops at limit + 1 ("longer than limit")
+    size_t count = icu4c_grapheme_len(ZSTR_VAL(text), ZSTR_LEN(text),
+        limit_is_null ? SIZE_MAX - 1 : (size_t)limit);
+    
+    if (count == 0 && ZSTR_LEN(text) > 0) {
+        // ICU4C could not be opened; 0 would look like empty text
+        php_error_docref(NULL, E_WARNING, "ICU4C could not segment the text");
+        RETURN_FALSE;
+    }
+    
+    RETURN_LONG((zend_long)count);
+}
+
+// icu4c_stats function implementation
+PHP_FUNCTION(icu4c_stats)
+{
+    bool reset = false;
+    
+    ZEND_PARSE_PARAMETERS_START(0, 1)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_BOOL(reset)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    const icu4c_stats *stats = &ICU4C_G(stats);
+    
+    array_init_size(return_value, 19);
+    add_assoc_long(return_value, "iterators_created", (zend_long)stats->iterators_created);
+    add_assoc_long(return_value, "bytes_segmented", (zend_long)stats->bytes_segmented);
+    add_assoc_long(return_value, "segments", (zend_long)stats->segments);
+    add_assoc_long(return_value, "fast_path_segments", (zend_long)stats->fast_path_segments);
+    add_assoc_long(return_value, "break_iterator_cache_hits", (zend_long)stats->break_iter_hits);
+    add_assoc_long(return_value, "break_iterator_cache_misses", (zend_long)stats->break_iter_misses);
+    add_assoc_long(return_value, "break_iterator_clones", (zend_long)stats->break_iter_clones);
+    add_assoc_long(return_value, "break_iterator_cache_evictions", (zend_long)stats->break_iter_evictions);
+    add_assoc_long(return_value, "boundary_reallocs", (zend_long)stats->boundary_reallocs);
+    add_assoc_long(return_value, "segment_cache_hits", (zend_long)stats->segment_cache_hits);
+    add_assoc_long(return_value, "segment_cache_persistent_hits", (zend_long)stats->segment_cache_persistent_hits);
+    add_assoc_long(return_value, "segment_cache_misses", (zend_long)stats->segment_cache_misses);
+    add_assoc_long(return_value, "segment_cache_evictions", (zend_long)stats->segment_cache_evictions);
+    add_assoc_long(return_value, "shared_index_hits", (zend_long)stats->shared_index_hits);
+    add_assoc_long(return_value, "parallel_segmentations", (zend_long)stats->parallel_segmentations);
+    add_assoc_long(return_value, "fallbacks", (zend_long)stats->fallbacks);
+    add_assoc_bool(return_value, "timers", ICU4C_G(stats_timers));
+    add_assoc_long(return_value, "segmentation_ns", (zend_long)stats->segmentation_ns);
+    add_assoc_long(return_value, "width_ns", (zend_long)stats->width_ns);
+    
+    if (reset) {
+        memset(&ICU4C_G(stats), 0, sizeof(icu4c_stats));
+    }
+}
+
 #ifdef HAVE_ICU4C
-// Count grapheme clusters and build boundary array
-size_t icu4c_count_grapheme_clusters(const char *text, size_t text_len, int32_t **boundaries)
+// Get a break iterator for (type, locale) from the per-thread LRU pool
+UBreakIterator *icu4c_break_iter_acquire(UBreakIteratorType type, const char *locale, UErrorCode *status)
 {
-    if (text_len == 0) {
-        *boundaries = NULL;
-        return 0;
+    if (!locale) {
+        locale = uloc_getDefault();
     }
     
+    zend_long pool_size = ICU4C_G(break_iter_cache_size);
+    icu4c_break_iter_entry *victim = NULL;
+    
+    if (pool_size > 0 && !ICU4C_G(break_iter_pool)) {
+        ICU4C_G(break_iter_pool) = pecalloc(pool_size, sizeof(icu4c_break_iter_entry), 1);
+    }
+    
+    for (zend_long i = 0; i < pool_size; i++) {
+        icu4c_break_iter_entry *entry = &ICU4C_G(break_iter_pool)[i];
+        
+        if (!entry->proto) {
+            if (!victim || victim->proto) {
+                victim = entry;
+            }
+            continue;
+        }
+        
+        if (entry->type != type || strcmp(entry->locale, locale) != 0) {
+            // Least recently used idle prototype is the eviction candidate
+            if (!entry->in_use && (!victim || (victim->proto && entry->last_used < victim->last_used))) {
+                victim = entry;
+            }
+            continue;
+        }
+        
+        ICU4C_G(stats).break_iter_hits++;
+        entry->last_used = ++ICU4C_G(break_iter_clock);
+        
+        if (!entry->in_use) {
+            // Lend the prototype itself; caller rebinds it with ubrk_setUText()
+            entry->in_use = true;
+            return entry->proto;
+        }
+        
+        // Prototype is busy (nested use): hand out a private clone
+        ICU4C_G(stats).break_iter_clones++;
+#if U_ICU_VERSION_MAJOR_NUM >= 69
+        return ubrk_clone(entry->proto, status);
+#else
+        return ubrk_safeClone(entry->proto, NULL, NULL, status);
+#endif
+    }
+    
+    ICU4C_G(stats).break_iter_misses++;
+    
+    UBreakIterator *bi = ubrk_open(type, locale, NULL, 0, status);
+    if (U_FAILURE(*status)) {
+        return NULL;
+    }
+    
+    // Keep the iterator as a prototype if the locale fits in a slot
+    if (victim && strlen(locale) < sizeof(victim->locale)) {
+        if (victim->proto) {
+            ubrk_close(victim->proto);
+            ICU4C_G(stats).break_iter_evictions++;
+        }
+        victim->type = type;
+        strcpy(victim->locale, locale);
+        victim->proto = bi;
+        victim->last_used = ++ICU4C_G(break_iter_clock);
+        victim->in_use = true;
+    }
+    
+    return bi;
+}
+
+// Return a break iterator obtained from icu4c_break_iter_acquire()
+void icu4c_break_iter_release(UBreakIterator *bi)
+{
+    if (!bi) {
+        return;
+    }
+    
+    for (zend_long i = 0; ICU4C_G(break_iter_pool) && i < ICU4C_G(break_iter_cache_size); i++) {
+        icu4c_break_iter_entry *entry = &ICU4C_G(break_iter_pool)[i];
+        
+        if (entry->proto == bi) {
+            entry->in_use = false;
+            return;
+        }
+    }
+    
+    // Not pooled (clone or overflow): close it
+    ubrk_close(bi);
+}
+#endif
+
+// Length of the leading ASCII run of str
+static size_t icu4c_ascii_span(const char *str, size_t len)
+{
+    size_t i = 0;
+    
+#ifdef __SSE2__
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)(str + i));
+        if (_mm_movemask_epi8(chunk) != 0) {
+            break;
+        }
+    }
+#endif
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, str + i, sizeof(word));
+        if (word & UINT64_C(0x8080808080808080)) {
+            break;
+        }
+    }
+    while (i < len && (unsigned char)str[i] < 0x80) {
+        i++;
+    }
+    
+    return i;
+}
+
+#ifdef HAVE_ICU4C
+// Byte length of a well-formed U+0080..U+00FF sequence at pos, 0 otherwise
+static zend_always_inline int32_t icu4c_latin1_len(const unsigned char *str, int32_t pos, int32_t len)
+{
+    if ((str[pos] == 0xC2 || str[pos] == 0xC3) && pos + 1 < len && (str[pos + 1] & 0xC0) == 0x80) {
+        return 2;
+    }
+    return 0;
+}
+
+// Bind ICU4C to the cursor text when the first complex span is reached
+static bool icu4c_break_cursor_start_icu(icu4c_break_cursor *cursor)
+{
     UErrorCode status = U_ZERO_ERROR;
-    UText *ut = utext_openUTF8(NULL, text, text_len, &status);
+    
+    cursor->utext = utext_openUTF8(NULL, cursor->text, cursor->text_len, &status);
     if (U_FAILURE(status)) {
-        *boundaries = NULL;
-        return 0;
+        cursor->utext = NULL;
+        cursor->failed = true;
+        ICU4C_G(stats).fallbacks++;
+        return false;
     }
     
-    UBreakIterator *bi = ubrk_open(UBRK_CHARACTER, uloc_getDefault(), NULL, 0, &status);
+    cursor->break_iter = icu4c_break_iter_acquire(cursor->type, cursor->locale, &status);
+    if (U_SUCCESS(status)) {
+        ubrk_setUText(cursor->break_iter, cursor->utext, &status);
+    }
     if (U_FAILURE(status)) {
-        utext_close(ut);
-        *boundaries = NULL;
-        return 0;
+        icu4c_break_cursor_close(cursor);
+        cursor->failed = true;
+        ICU4C_G(stats).fallbacks++;
+        return false;
     }
     
-    ubrk_setUText(bi, ut, &status);
-    if (U_FAILURE(status)) {
-        ubrk_close(bi);
-        utext_close(ut);
+    if (cursor->pos == 0) {
+        ubrk_first(cursor->break_iter);
+        cursor->synced = true;
+    }
+    
+    return true;
+}
+#endif
+
+// Prepare a cursor positioned at the start of text
+void icu4c_break_cursor_open(icu4c_break_cursor *cursor, const char *text, size_t text_len, UBreakIteratorType type, const char *locale)
+{
+    cursor->text = text;
+    cursor->text_len = (int32_t)text_len;
+    cursor->type = type;
+    cursor->locale = locale;
+    cursor->pos = 0;
+    cursor->rule_status = 0;
+    cursor->ascii_end = 0;
+#ifdef HAVE_ICU4C
+    cursor->break_iter = NULL;
+    cursor->utext = NULL;
+    cursor->synced = false;
+#endif
+    // Offsets are int32_t, as in ICU4C's UTF-8 UText
+    cursor->failed = text_len > INT32_MAX;
+}
+
+// Find the next boundary after the cursor position, or UBRK_DONE
+static zend_always_inline int32_t icu4c_break_cursor_step(icu4c_break_cursor *cursor)
+{
+    const unsigned char *str = (const unsigned char *)cursor->text;
+    int32_t len = cursor->text_len;
+    int32_t pos = cursor->pos;
+    
+    if (pos >= len || cursor->failed) {
+        return UBRK_DONE;
+    }
+    
+#ifdef HAVE_ICU4C
+    if (cursor->type != UBRK_CHARACTER) {
+        goto use_icu;
+    }
+#endif
+    
+    if (pos >= cursor->ascii_end) {
+        cursor->ascii_end = pos + (int32_t)icu4c_ascii_span(cursor->text + pos,
+            MIN(len - pos, ICU4C_ASCII_SCAN_WINDOW));
+    }
+    
+#ifdef HAVE_ICU4C
+    // A code point below U+0100 is never Extend, SpacingMark, Prepend or ZWJ,
+    // so two of them in a row are always separated by a boundary (except CR LF)
+    int32_t cp_len = pos < cursor->ascii_end ? 1 : icu4c_latin1_len(str, pos, len);
+    if (cp_len) {
+        int32_t next = pos + cp_len;
+        
+        if (next == len) {
+            cursor->synced = false;
+            ICU4C_G(stats).fast_path_segments++;
+            return cursor->pos = next;
+        }
+        if (str[pos] == '\r' && str[next] == '\n') {
+            cursor->synced = false;
+            ICU4C_G(stats).fast_path_segments++;
+            return cursor->pos = next + 1;
+        }
+        if (next < cursor->ascii_end || str[next] < 0x80 || icu4c_latin1_len(str, next, len)) {
+            cursor->synced = false;
+            ICU4C_G(stats).fast_path_segments++;
+            return cursor->pos = next;
+        }
+    }
+    
+use_icu:
+    // Complex span: let ICU4C decide, resuming from the last known boundary
+    if (!cursor->break_iter && !icu4c_break_cursor_start_icu(cursor)) {
+        return UBRK_DONE;
+    }
+    
+    int32_t boundary = cursor->synced
+        ? ubrk_next(cursor->break_iter)
+        : ubrk_following(cursor->break_iter, pos);
+    
+    if (boundary == UBRK_DONE) {
+        cursor->pos = len;
+        return UBRK_DONE;
+    }
+    
+    cursor->synced = true;
+    if (cursor->type == UBRK_WORD) {
+        cursor->rule_status = ubrk_getRuleStatus(cursor->break_iter);
+    }
+    return cursor->pos = boundary;
+#else
+    // Without ICU4C every code point is a segment: step over its continuation bytes
+    int32_t next = pos + 1;
+    
+    if (pos >= cursor->ascii_end) {
+        while (next < len && (str[next] & 0xC0) == 0x80) {
+            next++;
+        }
+    }
+    
+    if (cursor->type == UBRK_WORD) {
+        // Word mode keeps everything but ASCII spaces and punctuation
+        cursor->rule_status = str[pos] < 0x80 && !isalnum(str[pos]) ? UBRK_WORD_NONE : UBRK_WORD_LETTER;
+    }
+    
+    ICU4C_G(stats).fast_path_segments++;
+    return cursor->pos = next;
+#endif
+}
+
+// Return the next boundary after the cursor position, or UBRK_DONE
+int32_t icu4c_break_cursor_next(icu4c_break_cursor *cursor)
+{
+    int32_t pos = cursor->pos;
+    int32_t boundary = icu4c_break_cursor_step(cursor);
+    
+    if (boundary != UBRK_DONE) {
+        ICU4C_G(stats).segments++;
+        ICU4C_G(stats).bytes_segmented += boundary - pos;
+    }
+    
+    return boundary;
+}
+
+// Position a cursor at the end of its text, for icu4c_break_cursor_previous()
+void icu4c_break_cursor_last(icu4c_break_cursor *cursor)
+{
+    cursor->pos = cursor->failed ? 0 : cursor->text_len;
+    cursor->rule_status = 0;
+    cursor->ascii_end = 0;
+#ifdef HAVE_ICU4C
+    cursor->synced = false;
+#endif
+}
+
+#ifdef HAVE_ICU4C
+// Byte length of a U+0000..U+00FF code point ending at pos, 0 otherwise
+static zend_always_inline int32_t icu4c_latin1_len_before(const unsigned char *str, int32_t pos)
+{
+    if (pos >= 1 && str[pos - 1] < 0x80) {
+        return 1;
+    }
+    if (pos >= 2 && (str[pos - 2] == 0xC2 || str[pos - 2] == 0xC3) && (str[pos - 1] & 0xC0) == 0x80) {
+        return 2;
+    }
+    return 0;
+}
+#endif
+
+// Find the boundary before the cursor position, or UBRK_DONE at the start
+// of the text. In word mode rule_status describes the segment stepped over.
+static zend_always_inline int32_t icu4c_break_cursor_step_back(icu4c_break_cursor *cursor)
+{
+    const unsigned char *str = (const unsigned char *)cursor->text;
+    int32_t pos = cursor->pos;
+    
+    if (pos <= 0 || cursor->failed) {
+        return UBRK_DONE;
+    }
+    
+#ifdef HAVE_ICU4C
+    if (cursor->type == UBRK_CHARACTER) {
+        // Same rule as forward: a code point below U+0100 preceded by
+        // another one starts a cluster (except LF after CR)
+        int32_t cp_len = icu4c_latin1_len_before(str, pos);
+        if (cp_len) {
+            int32_t prev = pos - cp_len;
+            
+            if (prev >= 1 && str[prev] == '\n' && str[prev - 1] == '\r') {
+                cursor->synced = false;
+                ICU4C_G(stats).fast_path_segments++;
+                return cursor->pos = prev - 1;
+            }
+            if (prev == 0 || icu4c_latin1_len_before(str, prev)) {
+                cursor->synced = false;
+                ICU4C_G(stats).fast_path_segments++;
+                return cursor->pos = prev;
+            }
+        }
+    }
+    
+    if (!cursor->break_iter && !icu4c_break_cursor_start_icu(cursor)) {
+        return UBRK_DONE;
+    }
+    
+    if (!cursor->synced) {
+        if (pos == cursor->text_len) {
+            ubrk_last(cursor->break_iter);
+        } else {
+            ubrk_isBoundary(cursor->break_iter, pos);
+        }
+    }
+    
+    // The status of a boundary describes the segment that ends at it
+    if (cursor->type == UBRK_WORD) {
+        cursor->rule_status = ubrk_getRuleStatus(cursor->break_iter);
+    }
+    
+    int32_t boundary = ubrk_previous(cursor->break_iter);
+    
+    if (boundary == UBRK_DONE) {
+        cursor->pos = 0;
+        return UBRK_DONE;
+    }
+    
+    cursor->synced = true;
+    return cursor->pos = boundary;
+#else
+    // Without ICU4C every code point is a segment: step back to its lead byte
+    int32_t prev = pos - 1;
+    
+    while (prev > 0 && (str[prev] & 0xC0) == 0x80) {
+        prev--;
+    }
+    
+    if (cursor->type == UBRK_WORD) {
+        cursor->rule_status = str[prev] < 0x80 && !isalnum(str[prev]) ? UBRK_WORD_NONE : UBRK_WORD_LETTER;
+    }
+    
+    ICU4C_G(stats).fast_path_segments++;
+    return cursor->pos = prev;
+#endif
+}
+
+// Return the previous boundary before the cursor position, or UBRK_DONE
+int32_t icu4c_break_cursor_previous(icu4c_break_cursor *cursor)
+{
+    int32_t pos = cursor->pos;
+    int32_t boundary = icu4c_break_cursor_step_back(cursor);
+    
+    if (boundary != UBRK_DONE) {
+        ICU4C_G(stats).segments++;
+        ICU4C_G(stats).bytes_segmented += pos - boundary;
+    }
+    
+    return boundary;
+}
+
+// Release ICU4C resources held by a cursor
+void icu4c_break_cursor_close(icu4c_break_cursor *cursor)
+{
+#ifdef HAVE_ICU4C
+    if (cursor->break_iter) {
+        icu4c_break_iter_release(cursor->break_iter);
+        cursor->break_iter = NULL;
+    }
+    
+    if (cursor->utext) {
+        utext_close(cursor->utext);
+        cursor->utext = NULL;
+    }
+    
+    cursor->synced = false;
+#endif
+}
+
+// Growable boundary array filled by icu4c_parallel_segment()
+typedef struct _icu4c_boundary_list {
+    int32_t *boundaries;
+    size_t count;
+    size_t capacity;
+} icu4c_boundary_list;
+
+static void icu4c_boundary_list_add(void *ctx, int32_t boundary)
+{
+    icu4c_boundary_list *list = ctx;
+    
+    if (!list->boundaries) {
+        list->capacity = 1024;
+        list->boundaries = emalloc(list->capacity * sizeof(int32_t));
+        list->boundaries[list->count++] = 0;
+    }
+    
+    if (list->count >= list->capacity) {
+        list->capacity *= 2;
+        list->boundaries = erealloc(list->boundaries, list->capacity * sizeof(int32_t));
+        ICU4C_G(stats).boundary_reallocs++;
+    }
+    list->boundaries[list->count++] = boundary;
+}
+
+// Count grapheme clusters and build boundary array
+size_t icu4c_count_grapheme_clusters(const char *text, size_t text_len, int32_t **boundaries)
+{
+    if (text_len == 0) {
         *boundaries = NULL;
         return 0;
     }
     
+    // Very large text: segment chunks on worker threads when enabled
+    icu4c_boundary_list list = {NULL, 0, 0};
+    
+    if (icu4c_parallel_segment(text, text_len, icu4c_boundary_list_add, &list)) {
+        *boundaries = erealloc(list.boundaries, list.count * sizeof(int32_t));
+        return list.count - 1;
+    }
+    
+    ICU4C_TIMER_START(timer);
+    icu4c_break_cursor cursor;
+    icu4c_break_cursor_open(&cursor, text, text_len, UBRK_CHARACTER, NULL);
+    ICU4C_COUNT_FALLBACK();
+    
     // Count clusters and collect boundaries
     size_t cluster_count = 0;
     size_t boundary_capacity = 16;
     int32_t *boundary_array = emalloc(boundary_capacity * sizeof(int32_t));
     
-    int32_t previous = ubrk_first(bi);
-    if (previous == UBRK_DONE) {
-        ubrk_close(bi);
-        utext_close(ut);
-        efree(boundary_array);
-        *boundaries = NULL;
-        return 0;
-    }
-    
-    boundary_array[cluster_count++] = previous;
+    boundary_array[cluster_count++] = 0;
     
     int32_t current;
-    while ((current = ubrk_next(bi)) != UBRK_DONE) {
+    while ((current = icu4c_break_cursor_next(&cursor)) != UBRK_DONE) {
         if (cluster_count >= boundary_capacity) {
             boundary_capacity *= 2;
             boundary_array = erealloc(boundary_array, boundary_capacity * sizeof(int32_t));
+            ICU4C_G(stats).boundary_reallocs++;
         }
         boundary_array[cluster_count++] = current;
-        previous = current;
     }
     
-    ubrk_close(bi);
-    utext_close(ut);
+    icu4c_break_cursor_close(&cursor);
+    ICU4C_TIMER_STOP(timer, segmentation_ns);
+    
+    if (cursor.failed) {
+        efree(boundary_array);
+        *boundaries = NULL;
+        return 0;
+    }
     
     // Resize to actual size
     boundary_array = erealloc(boundary_array, cluster_count * sizeof(int32_t));
@@ -164,64 +751,63 @@ size_t icu4c_count_grapheme_clusters(const char *text, size_t text_len, int32_t
     return cluster_count - 1; // Number of clusters is boundaries - 1
 }
 
-// Get grapheme cluster at specific position
-zend_string *icu4c_get_cluster_at_position(const char *text, size_t text_len, const int32_t *boundaries, size_t cluster_index)
+// Count grapheme clusters without recording boundaries. Counting stops
+// once it passes limit, so the result is at most limit + 1.
+size_t icu4c_grapheme_len(const char *text, size_t text_len, size_t limit)
 {
-    if (boundaries == NULL || cluster_index >= text_len) {
-        return NULL;
+    if (text_len == 0) {
+        return 0;
     }
     
-    int32_t start = boundaries[cluster_index];
-    int32_t end = boundaries[cluster_index + 1];
+    // Pure ASCII: one cluster per byte, except that CR LF is one cluster.
+    // Only the prefix that can decide the answer is scanned: once limit + 2
+    // clusters start in it, the first limit + 1 are complete whatever follows
+    size_t want = MIN(limit, text_len) + 2;
+    size_t scan = 0;
+    size_t ascii_count = 0;
     
-    if (start >= 0 && end > start && end <= (int32_t)text_len) {
-        return zend_string_init(text + start, end - start, 0);
+    while (scan < text_len && ascii_count < want) {
+        size_t end = scan + MIN(want - ascii_count, text_len - scan);
+        
+        if (icu4c_ascii_span(text + scan, end - scan) != end - scan) {
+            break;
+        }
+        ascii_count += end - scan;
+#ifdef HAVE_ICU4C
+        // Start one byte back for a CR LF split across two windows
+        const char *cr = text + (scan > 0 ? scan - 1 : 0);
+        
+        while ((cr = memchr(cr, '\r', text + end - cr)) != NULL && ++cr < text + end) {
+            ascii_count -= *cr == '\n';
+        }
+#endif
+        scan = end;
     }
     
-    return NULL;
-}
-
-// Get first Unicode codepoint from UTF-8 string
-UChar32 icu4c_get_first_codepoint(const char *str, size_t len)
-{
-    if (len == 0) {
-        return -1;
+    if (scan == text_len) {
+        return MIN(ascii_count, limit + 1);
+    }
+    if (ascii_count >= want) {
+        return limit + 1;
     }
     
-    UChar32 codepoint;
-    int32_t index = 0;
-    
-    U8_NEXT(str, index, len, codepoint);
+    ICU4C_TIMER_START(timer);
+    icu4c_break_cursor cursor;
+    icu4c_break_cursor_open(&cursor, text, text_len, UBRK_CHARACTER, NULL);
+    ICU4C_COUNT_FALLBACK();
     
-    if (codepoint < 0) {
-        return -1;
+    size_t count = 0;
+    while (count <= limit && icu4c_break_cursor_next(&cursor) != UBRK_DONE) {
+        count++;
     }
     
-    return codepoint;
-}
-
-// Calculate display width based on East Asian Width property
-int icu4c_calculate_display_width(UEastAsianWidth eaw, zend_string *locale)
-{
-    switch (eaw) {
-        case U_EA_FULLWIDTH:  // [F] 全角
-        case U_EA_WIDE:       // [W] 広い
-            return 2;
-        
-        case U_EA_AMBIGUOUS:  // [A] 曖昧（コンテキスト依存）
-            if (locale && icu4c_is_east_asian_locale(ZSTR_VAL(locale))) {
-                return 2;  // 東アジア系ロケールでは全角扱い
-            }
-            return 1;  // その他では半角扱い
-        
-        case U_EA_HALFWIDTH:  // [H] 半角
-        case U_EA_NARROW:     // [Na] 狭い
-        case U_EA_NEUTRAL:    // [N] 中立
-        default:
-            return 1;
-    }
+    icu4c_break_cursor_close(&cursor);
+    ICU4C_TIMER_STOP(timer, segmentation_ns);
+    
+    return cursor.failed ? 0 : count;
 }
 
+#ifdef HAVE_ICU4C
 // Check if locale is East Asian
 bool icu4c_is_east_asian_locale(const char *locale)
 {
@@ -240,6 +826,18 @@ bool icu4c_is_east_asian_locale(const char *locale)
 const zend_function_entry icu4c_functions[] = {
     PHP_FE(icu4c_iter, arginfo_icu4c_iter)
     PHP_FE(icu4c_eaw_width, arginfo_icu4c_eaw_width)
+    PHP_FE(icu4c_graphemes, arginfo_icu4c_graphemes)
+    PHP_FE(icu4c_grapheme_len, arginfo_icu4c_grapheme_len)
+    PHP_FE(icu4c_str_width, arginfo_icu4c_str_width)
+    PHP_FE(icu4c_eaw_widths, arginfo_icu4c_eaw_widths)
+    PHP_FE(icu4c_iter_stream, arginfo_icu4c_iter_stream)
+    PHP_FE(icu4c_iter_file, arginfo_icu4c_iter_file)
+    PHP_FE(icu4c_stats, arginfo_icu4c_stats)
+#ifdef HAVE_ICU4C
+    PHP_FE(icu4c_str_truncate, arginfo_icu4c_str_truncate)
+    PHP_FE(icu4c_str_pad, arginfo_icu4c_str_pad)
+    PHP_FE(icu4c_wrap, arginfo_icu4c_wrap)
+#endif
     PHP_FE_END
 };
 
@@ -251,10 +849,14 @@ zend_module_entry icu4c_module_entry = {
     PHP_MINIT(icu4c),
     PHP_MSHUTDOWN(icu4c),
     NULL,
-    NULL,
+    PHP_RSHUTDOWN(icu4c),
     PHP_MINFO(icu4c),
     PHP_ICU4C_VERSION,
-    STANDARD_MODULE_PROPERTIES
+    PHP_MODULE_GLOBALS(icu4c),
+    PHP_GINIT(icu4c),
+    PHP_GSHUTDOWN(icu4c),
+    NULL,
+    STANDARD_MODULE_PROPERTIES_EX
 };
 
 #ifdef COMPILE_DL_ICU4C
@@ -264,11 +866,87 @@ ZEND_TSRMLS_CACHE_DEFINE()
 ZEND_GET_MODULE(icu4c)
 #endif
 
+// INI entries
+PHP_INI_BEGIN()
+    STD_PHP_INI_ENTRY("icu4c.break_iterator_cache_size", "8", PHP_INI_SYSTEM, OnUpdateLong,
+        break_iter_cache_size, zend_icu4c_globals, icu4c_globals)
+    STD_PHP_INI_ENTRY("icu4c.segment_cache_size", "0", PHP_INI_ALL, OnUpdateLong,
+        segment_cache_size, zend_icu4c_globals, icu4c_globals)
+    STD_PHP_INI_ENTRY("icu4c.persistent_segment_cache_size", "0", PHP_INI_SYSTEM, OnUpdateLong,
+        persistent_segment_cache_size, zend_icu4c_globals, icu4c_globals)
+    STD_PHP_INI_ENTRY("icu4c.parallel_threads", "0", PHP_INI_ALL, OnUpdateLong,
+        parallel_threads, zend_icu4c_globals, icu4c_globals)
+    STD_PHP_INI_ENTRY("icu4c.parallel_min_size", "4194304", PHP_INI_ALL, OnUpdateLong,
+        parallel_min_size, zend_icu4c_globals, icu4c_globals)
+    STD_PHP_INI_BOOLEAN("icu4c.stats_timers", "0", PHP_INI_ALL, OnUpdateBool,
+        stats_timers, zend_icu4c_globals, icu4c_globals)
+PHP_INI_END()
+
+// Per-thread globals initialization
+PHP_GINIT_FUNCTION(icu4c)
+{
+#if defined(COMPILE_DL_ICU4C) && defined(ZTS)
+    ZEND_TSRMLS_CACHE_UPDATE();
+#endif
+    memset(icu4c_globals, 0, sizeof(*icu4c_globals));
+    icu4c_globals->persistent_segment_cache.persistent = true;
+}
+
+// Per-thread globals shutdown: close pooled break iterators and free the
+// persistent segmentation cache
+PHP_GSHUTDOWN_FUNCTION(icu4c)
+{
+    icu4c_segment_cache_clear(&icu4c_globals->persistent_segment_cache);
+    
+#ifdef HAVE_ICU4C
+    if (icu4c_globals->break_iter_pool) {
+        for (zend_long i = 0; i < icu4c_globals->break_iter_cache_size; i++) {
+            icu4c_break_iter_entry *entry = &icu4c_globals->break_iter_pool[i];
+            
+            if (entry->proto) {
+                ubrk_close(entry->proto);
+            }
+        }
+        pefree(icu4c_globals->break_iter_pool, 1);
+        icu4c_globals->break_iter_pool = NULL;
+    }
+#endif
+}
+
 // Module initialization
 PHP_MINIT_FUNCTION(icu4c)
 {
+    REGISTER_INI_ENTRIES();
+    
     // Initialize ICU4CIterator class
     icu4c_iterator_init();
+    icu4c_stream_iterator_init();
+    
+    REGISTER_LONG_CONSTANT("ICU4C_ITER_OFFSETS", ICU4C_ITER_OFFSETS, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("ICU4C_ITER_SKIP_NONWORDS", ICU4C_ITER_SKIP_NONWORDS, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("ICU4C_ITER_REVERSE", ICU4C_ITER_REVERSE, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("ICU4C_BREAK_GRAPHEME", ICU4C_BREAK_GRAPHEME, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("ICU4C_BREAK_WORD", ICU4C_BREAK_WORD, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("ICU4C_BREAK_LINE", ICU4C_BREAK_LINE, CONST_CS | CONST_PERSISTENT);
+    REGISTER_LONG_CONSTANT("ICU4C_BREAK_SENTENCE", ICU4C_BREAK_SENTENCE, CONST_CS | CONST_PERSISTENT);
+    
+#ifdef HAVE_ICU4C
+    // Versions of the ICU4C library actually loaded and of its Unicode data
+    UVersionInfo version;
+    char version_str[U_MAX_VERSION_STRING_LENGTH];
+    
+    u_getVersion(version);
+    u_versionToString(version, version_str);
+    REGISTER_STRING_CONSTANT("ICU4C_ICU_VERSION", version_str, CONST_CS | CONST_PERSISTENT);
+    u_getUnicodeVersion(version);
+    u_versionToString(version, version_str);
+    REGISTER_STRING_CONSTANT("ICU4C_UNICODE_VERSION", version_str, CONST_CS | CONST_PERSISTENT);
+#endif
+    
+#ifdef HAVE_ICU4C
+    // Build the East Asian Width lookup table
+    icu4c_width_table_init();
+#endif
     
     return SUCCESS;
 }
@@ -276,9 +954,34 @@ PHP_MINIT_FUNCTION(icu4c)
 // Module shutdown
 PHP_MSHUTDOWN_FUNCTION(icu4c)
 {
+    UNREGISTER_INI_ENTRIES();
+    
+#ifdef HAVE_ICU4C
+    icu4c_width_table_shutdown();
+#endif
+    
+    return SUCCESS;
+}
+
+// Request shutdown: drop the per-request segmentation cache and the
+// indexes shared between iterators over interned strings
+PHP_RSHUTDOWN_FUNCTION(icu4c)
+{
+    icu4c_segment_cache_clear(&ICU4C_G(shared_indexes));
+    icu4c_segment_cache_clear(&ICU4C_G(segment_cache));
+    
     return SUCCESS;
 }
 
+// Print one phpinfo() row for a counter
+static void icu4c_info_print_counter(const char *label, zend_ulong value)
+{
+    char buf[32];
+    
+    snprintf(buf, sizeof(buf), ZEND_ULONG_FMT, value);
+    php_info_print_table_row(2, label, buf);
+}
+
 // Module info
 PHP_MINFO_FUNCTION(icu4c)
 {
@@ -298,4 +1001,33 @@ PHP_MINFO_FUNCTION(icu4c)
     php_info_print_table_row(2, "ICU4C support", "disabled");
 #endif
     php_info_print_table_end();
+    
+    // Instrumentation counters for the current thread (see icu4c_stats())
+    const icu4c_stats *stats = &ICU4C_G(stats);
+    
+    php_info_print_table_start();
+    php_info_print_table_header(2, "Statistics (this thread)", "Value");
+    icu4c_info_print_counter("Iterators created", stats->iterators_created);
+    icu4c_info_print_counter("Bytes segmented", stats->bytes_segmented);
+    icu4c_info_print_counter("Segments", stats->segments);
+    icu4c_info_print_counter("Segments found by the fast path", stats->fast_path_segments);
+    icu4c_info_print_counter("Break iterator cache hits", stats->break_iter_hits);
+    icu4c_info_print_counter("Break iterator cache misses", stats->break_iter_misses);
+    icu4c_info_print_counter("Break iterator clones", stats->break_iter_clones);
+    icu4c_info_print_counter("Break iterator cache evictions", stats->break_iter_evictions);
+    icu4c_info_print_counter("Boundary reallocations", stats->boundary_reallocs);
+    icu4c_info_print_counter("Segmentation cache hits", stats->segment_cache_hits);
+    icu4c_info_print_counter("Segmentation cache hits (persistent)", stats->segment_cache_persistent_hits);
+    icu4c_info_print_counter("Segmentation cache misses", stats->segment_cache_misses);
+    icu4c_info_print_counter("Segmentation cache evictions", stats->segment_cache_evictions);
+    icu4c_info_print_counter("Shared boundary indexes", stats->shared_index_hits);
+    icu4c_info_print_counter("Parallel segmentations", stats->parallel_segmentations);
+    icu4c_info_print_counter("Fallbacks", stats->fallbacks);
+    if (ICU4C_G(stats_timers)) {
+        icu4c_info_print_counter("Segmentation time (ns)", (zend_ulong)stats->segmentation_ns);
+        icu4c_info_print_counter("Width time (ns)", (zend_ulong)stats->width_ns);
+    }
+    php_info_print_table_end();
+    
+    DISPLAY_INI_ENTRIES();
 }
\ No newline at end of file
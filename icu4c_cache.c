@@ -0,0 +1,240 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "php_icu4c.h"
+
+// Hash of a cache key; the text's hash is computed once and kept in the zend_string
+static zend_ulong icu4c_segment_cache_hash(zend_string *text, zend_long mode, bool words_only, zend_string *locale)
+{
+    zend_ulong hash = zend_string_hash_val(text);
+    
+    hash = hash * 33 + (zend_ulong)((mode << 1) | (words_only ? 1 : 0));
+    if (locale) {
+        hash = hash * 33 + zend_string_hash_val(locale);
+    }
+    
+    return hash;
+}
+
+// Whether a text may be kept in the segmentation cache at all
+static zend_always_inline bool icu4c_segment_cache_cacheable(zend_string *text)
+{
+    return (ICU4C_G(segment_cache_size) > 0 || ICU4C_G(persistent_segment_cache_size) > 0)
+        && ZSTR_LEN(text) > 0 && ZSTR_LEN(text) <= ICU4C_SEGMENT_CACHE_MAX_TEXT;
+}
+
+// Find the index for a key, or NULL
+static icu4c_boundary_index *icu4c_segment_cache_find(icu4c_segment_cache *cache, zend_ulong hash,
+    zend_string *text, zend_long mode, bool words_only, zend_string *locale)
+{
+    if (!cache->entries) {
+        return NULL;
+    }
+    
+    icu4c_segment_cache_entry *set = &cache->entries[(hash & (cache->sets - 1)) * ICU4C_SEGMENT_CACHE_WAYS];
+    
+    for (int way = 0; way < ICU4C_SEGMENT_CACHE_WAYS; way++) {
+        icu4c_segment_cache_entry *entry = &set[way];
+        icu4c_boundary_index *index = entry->index;
+        
+        if (index && entry->hash == hash && index->mode == mode && index->words_only == words_only
+            && zend_string_equals(index->text, text)
+            && (index->locale && locale
+                ? zend_string_equals(index->locale, locale)
+                : index->locale == locale)) {
+            entry->last_used = ++cache->clock;
+            return index;
+        }
+    }
+    
+    return NULL;
+}
+
+// Copy a string into an index; persistent indexes need their own persistent copy
+static zend_string *icu4c_segment_cache_key_string(zend_string *str, bool persistent)
+{
+    if (!persistent) {
+        return zend_string_copy(str);
+    }
+    
+    zend_string *copy = zend_string_init(ZSTR_VAL(str), ZSTR_LEN(str), 1);
+    ZSTR_H(copy) = ZSTR_H(str);
+    return copy;
+}
+
+// Persistent copy of a finished index, with arrays trimmed to their contents
+static icu4c_boundary_index *icu4c_segment_cache_copy(const icu4c_boundary_index *src)
+{
+    icu4c_boundary_index *index = pemalloc(sizeof(icu4c_boundary_index), 1);
+    size_t checkpoints = ((MAX(src->total_clusters, 1) - 1) >> ICU4C_CHECKPOINT_SHIFT) + 1;
+    
+    memcpy(index, src, sizeof(icu4c_boundary_index));
+    index->refcount = 1;
+    index->persistent = true;
+    index->text = icu4c_segment_cache_key_string(src->text, true);
+    index->locale = src->locale ? icu4c_segment_cache_key_string(src->locale, true) : NULL;
+    index->cursor.text = ZSTR_VAL(index->text);
+    index->cursor.locale = index->locale ? ZSTR_VAL(index->locale) : NULL;
+    
+    index->lengths_capacity = MAX(src->total_clusters, 1);
+    index->cluster_lengths = pemalloc(index->lengths_capacity, 1);
+    memcpy(index->cluster_lengths, src->cluster_lengths, src->total_clusters);
+    index->checkpoint_capacity = checkpoints;
+    index->checkpoints = pemalloc(checkpoints * sizeof(icu4c_boundary_checkpoint), 1);
+    memcpy(index->checkpoints, src->checkpoints, checkpoints * sizeof(icu4c_boundary_checkpoint));
+    
+    index->length_overflow = NULL;
+    index->overflow_capacity = src->overflow_count;
+    if (src->overflow_count) {
+        index->length_overflow = pemalloc(src->overflow_count * sizeof(uint32_t), 1);
+        memcpy(index->length_overflow, src->length_overflow, src->overflow_count * sizeof(uint32_t));
+    }
+    
+    index->segment_index = NULL;
+    if (src->segment_index) {
+        index->segment_capacity = MAX(src->segment_count, 1);
+        index->segment_index = pemalloc(index->segment_capacity * sizeof(uint32_t), 1);
+        if (src->segment_count) {
+            memcpy(index->segment_index, src->segment_index, src->segment_count * sizeof(uint32_t));
+        }
+    }
+    
+    return index;
+}
+
+// Keep an index in a table, taking over the caller's reference. Returns
+// whether another entry was evicted to make room.
+static bool icu4c_segment_cache_insert(icu4c_segment_cache *cache, zend_long size, zend_ulong hash,
+    icu4c_boundary_index *index)
+{
+    if (!cache->entries) {
+        // Round the number of sets up to a power of two
+        size_t sets = 1;
+        while (sets * ICU4C_SEGMENT_CACHE_WAYS < (size_t)size) {
+            sets <<= 1;
+        }
+        cache->sets = sets;
+        cache->entries = pecalloc(sets * ICU4C_SEGMENT_CACHE_WAYS, sizeof(icu4c_segment_cache_entry), cache->persistent);
+    }
+    
+    // Empty slot first, else the least recently used entry of the set
+    icu4c_segment_cache_entry *set = &cache->entries[(hash & (cache->sets - 1)) * ICU4C_SEGMENT_CACHE_WAYS];
+    icu4c_segment_cache_entry *victim = &set[0];
+    bool evicted = false;
+    
+    for (int way = 0; way < ICU4C_SEGMENT_CACHE_WAYS && victim->index; way++) {
+        if (!set[way].index || set[way].last_used < victim->last_used) {
+            victim = &set[way];
+        }
+    }
+    
+    if (victim->index) {
+        icu4c_boundary_index_release(victim->index);
+        evicted = true;
+    }
+    
+    victim->index = index;
+    victim->hash = hash;
+    victim->last_used = ++cache->clock;
+    
+    return evicted;
+}
+
+// A reference to the cached index of a text, or NULL on a miss
+icu4c_boundary_index *icu4c_segment_cache_fetch(zend_string *text, zend_long mode, bool words_only, zend_string *locale)
+{
+    if (!icu4c_segment_cache_cacheable(text)) {
+        return NULL;
+    }
+    
+    zend_ulong hash = icu4c_segment_cache_hash(text, mode, words_only, locale);
+    icu4c_boundary_index *index = icu4c_segment_cache_find(&ICU4C_G(segment_cache), hash, text, mode, words_only, locale);
+    
+    if (index) {
+        ICU4C_G(stats).segment_cache_hits++;
+    } else if ((index = icu4c_segment_cache_find(&ICU4C_G(persistent_segment_cache), hash, text, mode, words_only, locale))) {
+        // Shared as is: iterators only read a finished index
+        ICU4C_G(stats).segment_cache_persistent_hits++;
+    } else {
+        ICU4C_G(stats).segment_cache_misses++;
+        return NULL;
+    }
+    
+    return icu4c_boundary_index_addref(index);
+}
+
+// Record an index that has just finished segmenting its text
+void icu4c_segment_cache_store(icu4c_boundary_index *index)
+{
+    if (!icu4c_segment_cache_cacheable(index->text) || index->cursor.failed) {
+        return;
+    }
+    
+    zend_ulong hash = icu4c_segment_cache_hash(index->text, index->mode, index->words_only, index->locale);
+    
+    if (ICU4C_G(segment_cache_size) > 0
+        && icu4c_segment_cache_insert(&ICU4C_G(segment_cache), ICU4C_G(segment_cache_size), hash,
+            icu4c_boundary_index_addref(index))) {
+        ICU4C_G(stats).segment_cache_evictions++;
+    }
+    
+    if (ICU4C_G(persistent_segment_cache_size) > 0
+        && icu4c_segment_cache_insert(&ICU4C_G(persistent_segment_cache), ICU4C_G(persistent_segment_cache_size),
+            hash, icu4c_segment_cache_copy(index))) {
+        ICU4C_G(stats).segment_cache_evictions++;
+    }
+}
+
+// A reference to the index of an earlier iterator over the same interned
+// text (finished or not), or NULL
+icu4c_boundary_index *icu4c_shared_index_fetch(zend_string *text, zend_long mode, bool words_only, zend_string *locale)
+{
+    if (!ZSTR_IS_INTERNED(text)) {
+        return NULL;
+    }
+    
+    zend_ulong hash = icu4c_segment_cache_hash(text, mode, words_only, locale);
+    icu4c_boundary_index *index = icu4c_segment_cache_find(&ICU4C_G(shared_indexes), hash, text, mode, words_only, locale);
+    
+    if (!index) {
+        return NULL;
+    }
+    
+    ICU4C_G(stats).shared_index_hits++;
+    return icu4c_boundary_index_addref(index);
+}
+
+// Offer a new index to later iterators over the same interned text. Interned
+// strings live at least until the end of the request, as does the map.
+void icu4c_shared_index_store(icu4c_boundary_index *index)
+{
+    if (!ZSTR_IS_INTERNED(index->text)) {
+        return;
+    }
+    
+    zend_ulong hash = icu4c_segment_cache_hash(index->text, index->mode, index->words_only, index->locale);
+    
+    icu4c_segment_cache_insert(&ICU4C_G(shared_indexes), ICU4C_SHARED_INDEX_SLOTS, hash,
+        icu4c_boundary_index_addref(index));
+}
+
+// Release all entries of a cache tier
+void icu4c_segment_cache_clear(icu4c_segment_cache *cache)
+{
+    if (!cache->entries) {
+        return;
+    }
+    
+    for (size_t i = 0; i < cache->sets * ICU4C_SEGMENT_CACHE_WAYS; i++) {
+        if (cache->entries[i].index) {
+            icu4c_boundary_index_release(cache->entries[i].index);
+        }
+    }
+    
+    pefree(cache->entries, cache->persistent);
+    cache->entries = NULL;
+    cache->sets = 0;
+    cache->clock = 0;
+}
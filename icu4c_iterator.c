@@ -3,11 +3,20 @@
 #endif
 
 #include "php.h"
+#include "zend_exceptions.h"
+#include "ext/spl/spl_exceptions.h"
 #include "php_icu4c.h"
 
 // Object handlers
 static zend_object_handlers icu4c_iterator_handlers;
 
+// Bytes sampled to estimate the segment count, and cap on the first allocation
+#define ICU4C_ESTIMATE_SAMPLE         256
+#define ICU4C_INITIAL_LENGTHS_MAX     65536
+
+// Position before the first segment, reached by prev() (key() is -1)
+#define ICU4C_POSITION_BEFORE_START   SIZE_MAX
+
 // Object creation function
 zend_object *icu4c_iterator_create_object(zend_class_entry *ce)
 {
@@ -20,36 +29,845 @@ zend_object *icu4c_iterator_create_object(zend_class_entry *ce)
     
     // Initialize fields
     obj->text = NULL;
-    obj->break_iter = NULL;
-    obj->utext = NULL;
+    obj->index = NULL;
+    obj->flags = 0;
     obj->current_pos = 0;
-    obj->total_clusters = 0;
-    obj->cluster_boundaries = NULL;
+    obj->from_last = false;
+    obj->seek_index = 0;
+    obj->seek_offset = 0;
+    obj->seek_overflow = 0;
     
     return &obj->std;
 }
 
-// Object destructor
-static void icu4c_iterator_free_object(zend_object *object)
+// Drop a reference to an index, freeing it with the last one
+void icu4c_boundary_index_release(icu4c_boundary_index *index)
 {
-    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(object);
+    if (--index->refcount > 0) {
+        return;
+    }
+    
+    bool persistent = index->persistent;
+    
+    icu4c_break_cursor_close(&index->cursor);
+    icu4c_break_cursor_close(&index->tail_cursor);
+    zend_string_release_ex(index->text, persistent);
+    
+    if (index->locale) {
+        zend_string_release_ex(index->locale, persistent);
+    }
+    
+    if (index->cluster_lengths) {
+        pefree(index->cluster_lengths, persistent);
+    }
+    
+    if (index->length_overflow) {
+        pefree(index->length_overflow, persistent);
+    }
+    
+    if (index->checkpoints) {
+        pefree(index->checkpoints, persistent);
+    }
+    
+    if (index->segment_index) {
+        pefree(index->segment_index, persistent);
+    }
+    
+    if (index->tail) {
+        pefree(index->tail, persistent);
+    }
+    
+    pefree(index, persistent);
+}
+
+// Release the text and boundaries of an iterator
+static void icu4c_iterator_release(icu4c_iterator_obj *obj)
+{
+    if (obj->index) {
+        icu4c_boundary_index_release(obj->index);
+        obj->index = NULL;
+    }
     
     if (obj->text) {
         zend_string_release(obj->text);
+        obj->text = NULL;
+    }
+    
+    obj->seek_index = 0;
+    obj->seek_offset = 0;
+    obj->seek_overflow = 0;
+}
+
+// Number of segments visible to the caller found so far
+static zend_always_inline size_t icu4c_boundary_index_visible(const icu4c_boundary_index *index)
+{
+    return index->words_only ? index->segment_count : index->total_clusters;
+}
+
+// Boundary index at which visible segment cluster_index starts
+static zend_always_inline size_t icu4c_iterator_boundary_of(const icu4c_iterator_obj *obj, size_t cluster_index)
+{
+    return obj->index->segment_index ? obj->index->segment_index[cluster_index] : cluster_index;
+}
+
+// Start offset of cluster index (total_clusters gives the end of the last
+// one): sums lengths from the nearest checkpoint, or from the previous
+// lookup when it is in the same block or just after it, so sequential
+// access is O(1) in both directions
+static int32_t icu4c_iterator_locate(icu4c_iterator_obj *obj, size_t index)
+{
+    const icu4c_boundary_index *boundaries = obj->index;
+    
+    if (index >= boundaries->total_clusters) {
+        return boundaries->end_offset;
+    }
+    
+    size_t i;
+    int32_t offset;
+    size_t overflow;
+    
+    if (obj->seek_index <= index && (obj->seek_index >> ICU4C_CHECKPOINT_SHIFT) == (index >> ICU4C_CHECKPOINT_SHIFT)) {
+        i = obj->seek_index;
+        offset = obj->seek_offset;
+        overflow = obj->seek_overflow;
+    } else if (obj->seek_index == index + 1) {
+        // One cluster back, as in reverse iteration
+        uint8_t len = boundaries->cluster_lengths[index];
+        
+        i = index;
+        overflow = obj->seek_overflow - (len == ICU4C_LENGTH_ESCAPE);
+        offset = obj->seek_offset - (len == ICU4C_LENGTH_ESCAPE ? (int32_t)boundaries->length_overflow[overflow] : len);
+    } else {
+        const icu4c_boundary_checkpoint *checkpoint = &boundaries->checkpoints[index >> ICU4C_CHECKPOINT_SHIFT];
+        
+        i = index & ~(size_t)(ICU4C_CHECKPOINT_INTERVAL - 1);
+        offset = (int32_t)checkpoint->offset;
+        overflow = checkpoint->overflow;
+    }
+    
+    for (; i < index; i++) {
+        uint8_t len = boundaries->cluster_lengths[i];
+        offset += len == ICU4C_LENGTH_ESCAPE ? (int32_t)boundaries->length_overflow[overflow++] : len;
+    }
+    
+    obj->seek_index = index;
+    obj->seek_offset = offset;
+    obj->seek_overflow = overflow;
+    
+    return offset;
+}
+
+// Byte length of the cluster last passed to icu4c_iterator_locate()
+static zend_always_inline int32_t icu4c_iterator_located_len(const icu4c_iterator_obj *obj)
+{
+    uint8_t len = obj->index->cluster_lengths[obj->seek_index];
+    return len == ICU4C_LENGTH_ESCAPE ? (int32_t)obj->index->length_overflow[obj->seek_overflow] : len;
+}
+
+// Rough number of segments in text: code points counted in a leading
+// sample, scaled to the whole text and divided by a typical segment size
+static size_t icu4c_iterator_estimate(const char *text, size_t text_len, zend_long mode)
+{
+    static const int mode_shift[] = {0, 2, 3, 6};  // Grapheme, word, line, sentence
+    size_t sample = MIN(text_len, ICU4C_ESTIMATE_SAMPLE);
+    size_t leads = 0;
+    
+    for (size_t i = 0; i < sample; i++) {
+        leads += ((unsigned char)text[i] & 0xC0) != 0x80;
+    }
+    
+    size_t estimate = (size_t)((double)text_len * leads / MAX(sample, 1)) >> mode_shift[mode];
+    return MAX(estimate, 1);
+}
+
+// Make room for one more cluster. Capacity grows towards the total
+// projected from the segment density seen so far, never past one
+// cluster per remaining byte.
+static void icu4c_boundary_index_reserve(icu4c_boundary_index *index)
+{
+    size_t total = index->total_clusters;
+    
+    if (total < index->lengths_capacity) {
+        return;
+    }
+    
+    size_t remaining = ZSTR_LEN(index->text) - index->end_offset;
+    size_t projected = total + (size_t)((double)remaining * total / MAX(index->end_offset, 1));
+    size_t capacity = MAX(projected + projected / 16, total + total / 2);
+    
+    capacity = MAX(MIN(capacity, total + remaining), total + 1);
+    
+    index->lengths_capacity = capacity;
+    index->cluster_lengths = erealloc(index->cluster_lengths, capacity);
+    index->checkpoint_capacity = (capacity >> ICU4C_CHECKPOINT_SHIFT) + 1;
+    index->checkpoints = erealloc(index->checkpoints, index->checkpoint_capacity * sizeof(icu4c_boundary_checkpoint));
+    ICU4C_G(stats).boundary_reallocs++;
+}
+
+// Record the cluster ending at boundary
+static void icu4c_boundary_index_append(icu4c_boundary_index *index, int32_t boundary)
+{
+    size_t i = index->total_clusters;
+    uint32_t len = (uint32_t)(boundary - index->end_offset);
+    
+    icu4c_boundary_index_reserve(index);
+    
+    if ((i & (ICU4C_CHECKPOINT_INTERVAL - 1)) == 0) {
+        index->checkpoints[i >> ICU4C_CHECKPOINT_SHIFT].offset = (uint32_t)index->end_offset;
+        index->checkpoints[i >> ICU4C_CHECKPOINT_SHIFT].overflow = (uint32_t)index->overflow_count;
+    }
+    
+    if (len < ICU4C_LENGTH_ESCAPE) {
+        index->cluster_lengths[i] = (uint8_t)len;
+    } else {
+        // Rare long cluster (e.g. stacked combining marks, long words)
+        if (index->overflow_count >= index->overflow_capacity) {
+            index->overflow_capacity = index->overflow_capacity ? index->overflow_capacity * 2 : 8;
+            index->length_overflow = erealloc(index->length_overflow, index->overflow_capacity * sizeof(uint32_t));
+            ICU4C_G(stats).boundary_reallocs++;
+        }
+        index->cluster_lengths[i] = ICU4C_LENGTH_ESCAPE;
+        index->length_overflow[index->overflow_count++] = len;
+    }
+    
+    index->total_clusters = i + 1;
+    index->end_offset = boundary;
+}
+
+// Mark segmentation as finished and shrink the boundary storage
+static void icu4c_boundary_index_finish(icu4c_boundary_index *index)
+{
+    icu4c_break_cursor_close(&index->cursor);
+    index->complete = true;
+    
+    // Reverse iterators switch to the complete boundaries
+    icu4c_break_cursor_close(&index->tail_cursor);
+    if (index->tail) {
+        efree(index->tail);
+        index->tail = NULL;
+        index->tail_count = 0;
+        index->tail_capacity = 0;
+    }
+    
+    if (index->cluster_lengths && index->lengths_capacity > MAX(index->total_clusters, 1)) {
+        index->lengths_capacity = MAX(index->total_clusters, 1);
+        index->cluster_lengths = erealloc(index->cluster_lengths, index->lengths_capacity);
+        index->checkpoint_capacity = ((index->lengths_capacity - 1) >> ICU4C_CHECKPOINT_SHIFT) + 1;
+        index->checkpoints = erealloc(index->checkpoints, index->checkpoint_capacity * sizeof(icu4c_boundary_checkpoint));
+    }
+    
+    if (index->length_overflow && index->overflow_capacity > index->overflow_count) {
+        index->overflow_capacity = MAX(index->overflow_count, 1);
+        index->length_overflow = erealloc(index->length_overflow, index->overflow_capacity * sizeof(uint32_t));
+    }
+    
+    if (index->segment_index && index->segment_capacity > index->segment_count) {
+        index->segment_capacity = MAX(index->segment_count, 1);
+        index->segment_index = erealloc(index->segment_index, index->segment_capacity * sizeof(uint32_t));
+    }
+    
+    icu4c_segment_cache_store(index);
+}
+
+// Advance the boundary cursor until cluster_index is known (or text ends)
+static bool icu4c_boundary_index_fill(icu4c_boundary_index *index, size_t cluster_index)
+{
+    if (index->complete || cluster_index < icu4c_boundary_index_visible(index)) {
+        return cluster_index < icu4c_boundary_index_visible(index);
+    }
+    
+    ICU4C_TIMER_START(timer);
+    
+    if (index->total_clusters == 0) {
+        ICU4C_COUNT_FALLBACK();
+    }
+    
+    while (!index->complete && icu4c_boundary_index_visible(index) <= cluster_index) {
+        int32_t current = icu4c_break_cursor_next(&index->cursor);
+        
+        if (current == UBRK_DONE) {
+            icu4c_boundary_index_finish(index);
+            break;
+        }
+        
+        icu4c_boundary_index_append(index, current);
+        
+        // Word mode: keep only segments whose rule status marks a word
+        if (index->segment_index && index->cursor.rule_status >= UBRK_WORD_NONE_LIMIT) {
+            if (index->segment_count >= index->segment_capacity) {
+                index->segment_capacity *= 2;
+                index->segment_index = erealloc(index->segment_index, index->segment_capacity * sizeof(uint32_t));
+                ICU4C_G(stats).boundary_reallocs++;
+            }
+            index->segment_index[index->segment_count++] = (uint32_t)(index->total_clusters - 1);
+        }
+    }
+    
+    ICU4C_TIMER_STOP(timer, segmentation_ns);
+    return cluster_index < icu4c_boundary_index_visible(index);
+}
+
+// Step the backward cursor until the segment position places from the
+// end is known (or the start of the text is reached). A complete index
+// already knows every segment.
+static bool icu4c_boundary_index_fill_tail(icu4c_boundary_index *index, size_t position)
+{
+    if (index->complete) {
+        return position < icu4c_boundary_index_visible(index);
+    }
+    
+    if (position < index->tail_count || index->tail_complete) {
+        return position < index->tail_count;
+    }
+    
+    ICU4C_TIMER_START(timer);
+    
+    if (!index->tail) {
+        index->tail_capacity = 16;
+        index->tail = emalloc(index->tail_capacity * sizeof(icu4c_boundary_span));
+        icu4c_break_cursor_open(&index->tail_cursor, ZSTR_VAL(index->text), ZSTR_LEN(index->text),
+            (UBreakIteratorType)index->mode, index->locale ? ZSTR_VAL(index->locale) : NULL);
+        icu4c_break_cursor_last(&index->tail_cursor);
+        ICU4C_COUNT_FALLBACK();
+    }
+    
+    while (index->tail_count <= position) {
+        int32_t end = index->tail_cursor.pos;
+        int32_t start = icu4c_break_cursor_previous(&index->tail_cursor);
+        
+        if (start == UBRK_DONE) {
+            icu4c_break_cursor_close(&index->tail_cursor);
+            index->tail_complete = true;
+            break;
+        }
+        
+        // Word mode: keep only segments whose rule status marks a word
+        if (index->words_only && index->tail_cursor.rule_status < UBRK_WORD_NONE_LIMIT) {
+            continue;
+        }
+        
+        if (index->tail_count >= index->tail_capacity) {
+            index->tail_capacity *= 2;
+            index->tail = erealloc(index->tail, index->tail_capacity * sizeof(icu4c_boundary_span));
+            ICU4C_G(stats).boundary_reallocs++;
+        }
+        index->tail[index->tail_count].start = start;
+        index->tail[index->tail_count].len = end - start;
+        index->tail_count++;
+    }
+    
+    ICU4C_TIMER_STOP(timer, segmentation_ns);
+    return position < index->tail_count;
+}
+
+// Whether the segment at position exists, segmenting up to it if needed.
+// Positions count from the end of the text if reverse.
+static zend_always_inline bool icu4c_iterator_fill_from(icu4c_iterator_obj *obj, size_t position, bool reverse)
+{
+    if (!obj->index || position == ICU4C_POSITION_BEFORE_START) {
+        return false;
+    }
+    
+    if (reverse) {
+        return icu4c_boundary_index_fill_tail(obj->index, position);
+    }
+    
+    return icu4c_boundary_index_fill(obj->index, position);
+}
+
+// Same, with positions in the iterator's direction
+static zend_always_inline bool icu4c_iterator_fill(icu4c_iterator_obj *obj, size_t position)
+{
+    return icu4c_iterator_fill_from(obj, position, (obj->flags & ICU4C_ITER_REVERSE) != 0);
+}
+
+// Whether the iterator is on a segment. After last() the position counts
+// back from the last segment, i.e. in the opposite direction.
+static zend_always_inline bool icu4c_iterator_fill_current(icu4c_iterator_obj *obj)
+{
+    return icu4c_iterator_fill_from(obj, obj->current_pos, ((obj->flags & ICU4C_ITER_REVERSE) != 0) != obj->from_last);
+}
+
+// Destination of boundaries found by icu4c_parallel_segment()
+typedef struct _icu4c_parallel_target {
+    icu4c_boundary_index *index;
+    int32_t base;  // Offset of the segmented part in the text
+} icu4c_parallel_target;
+
+static void icu4c_boundary_index_emit(void *ctx, int32_t boundary)
+{
+    icu4c_parallel_target *target = ctx;
+    icu4c_boundary_index_append(target->index, target->base + boundary);
+}
+
+// Count all clusters, finishing segmentation if needed
+static size_t icu4c_iterator_count(icu4c_iterator_obj *obj)
+{
+    icu4c_boundary_index *index = obj->index;
+    
+    if (!index) {
+        return 0;
+    }
+    
+    // The rest of a large grapheme text may be segmented on worker threads;
+    // end_offset is a boundary, so segmentation can restart from it
+    if (!index->complete && index->mode == ICU4C_BREAK_GRAPHEME && !index->locale) {
+        icu4c_parallel_target target = {index, index->end_offset};
+        
+        if (icu4c_parallel_segment(ZSTR_VAL(index->text) + target.base, ZSTR_LEN(index->text) - target.base,
+                icu4c_boundary_index_emit, &target)) {
+            icu4c_boundary_index_finish(index);
+        }
+    }
+    
+    icu4c_boundary_index_fill(index, SIZE_MAX - 1);
+    return icu4c_boundary_index_visible(index);
+}
+
+// New index over text; only its storage is allocated here
+static icu4c_boundary_index *icu4c_boundary_index_create(zend_string *text, zend_long mode, bool words_only,
+    zend_string *locale)
+{
+    icu4c_boundary_index *index = ecalloc(1, sizeof(icu4c_boundary_index));
+    
+    index->refcount = 1;
+    index->words_only = words_only;
+    index->mode = mode;
+    index->text = zend_string_copy(text);
+    index->locale = locale ? zend_string_copy(locale) : NULL;
+    index->complete = true;
+    
+    icu4c_break_cursor_open(&index->cursor, ZSTR_VAL(text), ZSTR_LEN(text), (UBreakIteratorType)mode,
+        locale ? ZSTR_VAL(locale) : NULL);
+    
+    if (ZSTR_LEN(text) == 0 || index->cursor.failed) {
+        return index;
+    }
+    
+    // Size the boundary storage for the whole text up front when it is small
+    index->lengths_capacity = MIN(icu4c_iterator_estimate(ZSTR_VAL(text), ZSTR_LEN(text), mode), ICU4C_INITIAL_LENGTHS_MAX);
+    index->cluster_lengths = emalloc(index->lengths_capacity);
+    index->checkpoint_capacity = (index->lengths_capacity >> ICU4C_CHECKPOINT_SHIFT) + 1;
+    index->checkpoints = emalloc(index->checkpoint_capacity * sizeof(icu4c_boundary_checkpoint));
+    
+    if (words_only) {
+        index->segment_capacity = 16;
+        index->segment_index = emalloc(index->segment_capacity * sizeof(uint32_t));
+    }
+    
+    index->complete = false;
+    return index;
+}
+
+// Validate icu4c_iter() / ICU4CIterator flags and mode arguments
+bool icu4c_iterator_check_args(zend_long flags, zend_long mode, uint32_t arg_num)
+{
+    if (flags & ~ICU4C_ITER_FLAGS_MASK) {
+        zend_argument_value_error(arg_num, "must be a combination of ICU4C_ITER_* constants");
+        return false;
+    }
+    
+    if (mode < ICU4C_BREAK_GRAPHEME || mode > ICU4C_BREAK_SENTENCE) {
+        zend_argument_value_error(arg_num + 1, "must be one of the ICU4C_BREAK_* constants");
+        return false;
+    }
+    
+    if ((flags & ICU4C_ITER_SKIP_NONWORDS) && mode != ICU4C_BREAK_WORD) {
+        zend_argument_value_error(arg_num, "may only contain ICU4C_ITER_SKIP_NONWORDS with ICU4C_BREAK_WORD");
+        return false;
+    }
+    
+    return true;
+}
+
+// Serialized boundary block: this header, then the checkpoints, length
+// overflow and word segment index of a finished index, then its lengths.
+// Integers are in machine byte order; the magic number rejects others.
+#define ICU4C_SERIALIZE_MAGIC         0x49434231  // "ICB1"
+
+typedef struct _icu4c_serialized_header {
+    uint32_t magic;
+    uint32_t total_clusters;
+    uint32_t overflow_count;
+    uint32_t segment_count;
+} icu4c_serialized_header;
+
+// Checkpoints kept for total clusters
+static zend_always_inline size_t icu4c_boundary_index_checkpoints(size_t total)
+{
+    return total ? ((total - 1) >> ICU4C_CHECKPOINT_SHIFT) + 1 : 0;
+}
+
+// Version of the segmentation rules: serialized boundaries are only
+// trusted by the same ICU4C (and Unicode) version
+static void icu4c_segmentation_version(char *buf, size_t size)
+{
+#ifdef HAVE_ICU4C
+    UVersionInfo icu, unicode;
+    char icu_str[U_MAX_VERSION_STRING_LENGTH], unicode_str[U_MAX_VERSION_STRING_LENGTH];
+    
+    u_getVersion(icu);
+    u_getUnicodeVersion(unicode);
+    u_versionToString(icu, icu_str);
+    u_versionToString(unicode, unicode_str);
+    snprintf(buf, size, "ICU %s; Unicode %s", icu_str, unicode_str);
+#else
+    snprintf(buf, size, "code points");
+#endif
+}
+
+// Boundary block of a finished index
+static zend_string *icu4c_boundary_index_dump(const icu4c_boundary_index *index)
+{
+    icu4c_serialized_header header = {
+        ICU4C_SERIALIZE_MAGIC,
+        (uint32_t)index->total_clusters,
+        (uint32_t)index->overflow_count,
+        (uint32_t)(index->segment_index ? index->segment_count : 0),
+    };
+    size_t checkpoints = icu4c_boundary_index_checkpoints(header.total_clusters) * sizeof(icu4c_boundary_checkpoint);
+    size_t overflow = header.overflow_count * sizeof(uint32_t);
+    size_t segments = header.segment_count * sizeof(uint32_t);
+    zend_string *block = zend_string_alloc(sizeof(header) + checkpoints + overflow + segments + header.total_clusters, 0);
+    char *out = ZSTR_VAL(block);
+    
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    if (checkpoints) {
+        memcpy(out, index->checkpoints, checkpoints);
+        out += checkpoints;
+    }
+    if (overflow) {
+        memcpy(out, index->length_overflow, overflow);
+        out += overflow;
+    }
+    if (segments) {
+        memcpy(out, index->segment_index, segments);
+        out += segments;
+    }
+    if (header.total_clusters) {
+        memcpy(out, index->cluster_lengths, header.total_clusters);
+        out += header.total_clusters;
+    }
+    *out = '\0';
+    
+    return block;
+}
+
+// Copy one array out of a boundary block
+static void *icu4c_boundary_index_take(const char **in, size_t size)
+{
+    void *array = emalloc(MAX(size, 1));
+    
+    if (size) {
+        memcpy(array, *in, size);
+        *in += size;
+    }
+    
+    return array;
+}
+
+// Finished index over text from a boundary block, or NULL if the block does
+// not describe text exactly. The arrays are copied as they are; one pass
+// over the lengths checks that every offset they lead to stays inside text.
+static icu4c_boundary_index *icu4c_boundary_index_load(zend_string *text, zend_long mode, bool words_only,
+    zend_string *locale, zend_string *block)
+{
+    icu4c_serialized_header header;
+    
+    if (ZSTR_LEN(block) < sizeof(header)) {
+        return NULL;
+    }
+    
+    memcpy(&header, ZSTR_VAL(block), sizeof(header));
+    
+    size_t total = header.total_clusters;
+    size_t checkpoints = icu4c_boundary_index_checkpoints(total);
+    
+    if (header.magic != ICU4C_SERIALIZE_MAGIC || total > ZSTR_LEN(text) || header.overflow_count > total
+        || header.segment_count > total || (header.segment_count && !words_only)
+        || ZSTR_LEN(block) != sizeof(header) + checkpoints * sizeof(icu4c_boundary_checkpoint)
+            + ((size_t)header.overflow_count + header.segment_count) * sizeof(uint32_t) + total) {
+        return NULL;
+    }
+    
+    const char *in = ZSTR_VAL(block) + sizeof(header);
+    icu4c_boundary_index *index = ecalloc(1, sizeof(icu4c_boundary_index));
+    
+    index->refcount = 1;
+    index->words_only = words_only;
+    index->complete = true;
+    index->mode = mode;
+    index->text = zend_string_copy(text);
+    index->locale = locale ? zend_string_copy(locale) : NULL;
+    index->total_clusters = total;
+    index->checkpoint_capacity = MAX(checkpoints, 1);
+    index->checkpoints = icu4c_boundary_index_take(&in, checkpoints * sizeof(icu4c_boundary_checkpoint));
+    index->overflow_count = index->overflow_capacity = header.overflow_count;
+    index->length_overflow = header.overflow_count
+        ? icu4c_boundary_index_take(&in, header.overflow_count * sizeof(uint32_t)) : NULL;
+    if (words_only) {
+        index->segment_count = header.segment_count;
+        index->segment_capacity = MAX(header.segment_count, 1);
+        index->segment_index = icu4c_boundary_index_take(&in, header.segment_count * sizeof(uint32_t));
+    }
+    index->lengths_capacity = MAX(total, 1);
+    index->cluster_lengths = icu4c_boundary_index_take(&in, total);
+    
+    // Lengths must tile the text and agree with the checkpoints
+    size_t offset = 0;
+    size_t overflow = 0;
+    bool valid = true;
+    
+    for (size_t i = 0; valid && i < total; i++) {
+        size_t len = index->cluster_lengths[i];
+        
+        if ((i & (ICU4C_CHECKPOINT_INTERVAL - 1)) == 0) {
+            const icu4c_boundary_checkpoint *checkpoint = &index->checkpoints[i >> ICU4C_CHECKPOINT_SHIFT];
+            valid = checkpoint->offset == offset && checkpoint->overflow == overflow;
+        }
+        
+        if (len == ICU4C_LENGTH_ESCAPE) {
+            len = overflow < index->overflow_count ? index->length_overflow[overflow++] : 0;
+            valid = valid && len >= ICU4C_LENGTH_ESCAPE;
+        }
+        
+        valid = valid && len > 0 && len <= ZSTR_LEN(text) - offset;
+        offset += len;
+    }
+    
+    valid = valid && offset == ZSTR_LEN(text) && overflow == index->overflow_count;
+    
+    // Word segments are boundary indexes in increasing order
+    for (size_t i = 0; valid && i < index->segment_count; i++) {
+        valid = index->segment_index[i] < total && (i == 0 || index->segment_index[i] > index->segment_index[i - 1]);
+    }
+    
+    if (!valid) {
+        icu4c_boundary_index_release(index);
+        return NULL;
+    }
+    
+    index->end_offset = (int32_t)offset;
+    return index;
+}
+
+// Attach text to an iterator; only the first boundary is computed here.
+// An index already built for the same text and segmentation is shared.
+void icu4c_iterator_setup(icu4c_iterator_obj *obj, zend_string *text, zend_long flags, zend_long mode, zend_string *locale)
+{
+    bool words_only = (flags & ICU4C_ITER_SKIP_NONWORDS) != 0;
+    
+    obj->text = zend_string_copy(text);
+    obj->flags = flags;
+    obj->current_pos = 0;
+    obj->from_last = false;
+    obj->seek_index = 0;
+    obj->seek_offset = 0;
+    obj->seek_overflow = 0;
+    ICU4C_G(stats).iterators_created++;
+    
+    // The same interned string (e.g. a literal in a loop): the index of an
+    // earlier iterator, however far it got; else a finished one from the
+    // segmentation cache
+    obj->index = icu4c_shared_index_fetch(text, mode, words_only, locale);
+    if (!obj->index) {
+        obj->index = icu4c_segment_cache_fetch(text, mode, words_only, locale);
+    }
+    
+    if (!obj->index) {
+        obj->index = icu4c_boundary_index_create(text, mode, words_only, locale);
+        icu4c_shared_index_store(obj->index);
+    }
+}
+
+// Byte range of a known visible segment, counting from the end of the
+// text if reverse
+static void icu4c_iterator_span_from(icu4c_iterator_obj *obj, size_t cluster_index, bool reverse,
+    size_t *start, size_t *len)
+{
+    const icu4c_boundary_index *index = obj->index;
+    
+    if (reverse) {
+        if (!index->complete) {
+            *start = (size_t)index->tail[cluster_index].start;
+            *len = (size_t)index->tail[cluster_index].len;
+            return;
+        }
+        cluster_index = icu4c_boundary_index_visible(index) - 1 - cluster_index;
     }
     
-    if (obj->cluster_boundaries) {
-        efree(obj->cluster_boundaries);
+    *start = (size_t)icu4c_iterator_locate(obj, icu4c_iterator_boundary_of(obj, cluster_index));
+    *len = (size_t)icu4c_iterator_located_len(obj);
+}
+
+// Same, with positions in the iterator's direction
+static zend_always_inline void icu4c_iterator_span(icu4c_iterator_obj *obj, size_t cluster_index, size_t *start, size_t *len)
+{
+    icu4c_iterator_span_from(obj, cluster_index, (obj->flags & ICU4C_ITER_REVERSE) != 0, start, len);
+}
+
+// Build the value for the segment at start: its string, or [start, length] in offsets mode
+static void icu4c_iterator_make_value(icu4c_iterator_obj *obj, size_t start, size_t len, zval *value)
+{
+    if (obj->flags & ICU4C_ITER_OFFSETS) {
+        array_init_size(value, 2);
+        add_next_index_long(value, (zend_long)start);
+        add_next_index_long(value, (zend_long)len);
+        return;
     }
     
+    if (len == 1) {
+        ZVAL_CHAR(value, (zend_uchar)ZSTR_VAL(obj->text)[start]);
+        return;
+    }
+    
+    ZVAL_STRINGL(value, ZSTR_VAL(obj->text) + start, len);
+}
+
+// Build the value for a known cluster
+static void icu4c_iterator_get_value(icu4c_iterator_obj *obj, size_t cluster_index, zval *value)
+{
+    size_t start, len;
+    
+    icu4c_iterator_span(obj, cluster_index, &start, &len);
+    icu4c_iterator_make_value(obj, start, len, value);
+}
+
+// Turn a position counted back from the last segment (see last()) into an
+// ordinary one, which needs the number of segments
+static void icu4c_iterator_resolve_position(icu4c_iterator_obj *obj)
+{
+    if (!obj->from_last) {
+        return;
+    }
+    
+    size_t count = icu4c_iterator_count(obj);
+    
+    // Before the last segment counting back is past the end counting forward
+    obj->from_last = false;
+    obj->current_pos = obj->current_pos == ICU4C_POSITION_BEFORE_START ? count
+        : obj->current_pos < count ? count - 1 - obj->current_pos : 0;
+}
+
+// Segment index for an ArrayAccess offset, or false (with a TypeError) if it is not an int
+static bool icu4c_iterator_offset_index(zval *offset, zend_long *index)
+{
+    if (Z_TYPE_P(offset) != IS_LONG) {
+        zend_type_error("ICU4CIterator offset must be of type int, %s given", zend_zval_type_name(offset));
+        return false;
+    }
+    
+    *index = Z_LVAL_P(offset);
+    return true;
+}
+
+// Whether segment index exists, segmenting up to it if needed
+static zend_always_inline bool icu4c_iterator_has(icu4c_iterator_obj *obj, zend_long index)
+{
+    return obj->text && index >= 0 && icu4c_iterator_fill(obj, (size_t)index);
+}
+
+// read_dimension handler: $iterator[$index]
+static zval *icu4c_iterator_read_dimension(zend_object *object, zval *offset, int type, zval *rv)
+{
+    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(object);
+    zend_long index;
+    
+    if (type != BP_VAR_R && type != BP_VAR_IS) {
+        zend_throw_error(NULL, "Cannot modify ICU4CIterator segments");
+        return &EG(uninitialized_zval);
+    }
+    
+    if (!offset) {
+        zend_throw_error(NULL, "Cannot append to ICU4CIterator");
+        return &EG(uninitialized_zval);
+    }
+    
+    if (!icu4c_iterator_offset_index(offset, &index)) {
+        return &EG(uninitialized_zval);
+    }
+    
+    if (!icu4c_iterator_has(obj, index)) {
+        if (type != BP_VAR_IS) {
+            zend_throw_exception_ex(spl_ce_OutOfBoundsException, 0, "Offset " ZEND_LONG_FMT " is out of range", index);
+        }
+        return &EG(uninitialized_zval);
+    }
+    
+    icu4c_iterator_get_value(obj, (size_t)index, rv);
+    return rv;
+}
+
+// has_dimension handler: isset($iterator[$index]) / empty($iterator[$index])
+static int icu4c_iterator_has_dimension(zend_object *object, zval *offset, int check_empty)
+{
+    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(object);
+    zend_long index;
+    
+    if (!icu4c_iterator_offset_index(offset, &index) || !icu4c_iterator_has(obj, index)) {
+        return 0;
+    }
+    
+    if (check_empty && !(obj->flags & ICU4C_ITER_OFFSETS)) {
+        // Only the segment "0" is empty()
+        size_t start, len;
+        icu4c_iterator_span(obj, (size_t)index, &start, &len);
+        return !(len == 1 && ZSTR_VAL(obj->text)[start] == '0');
+    }
+    
+    return 1;
+}
+
+// write_dimension / unset_dimension handlers: segments are read-only
+static void icu4c_iterator_write_dimension(zend_object *object, zval *offset, zval *value)
+{
+    zend_throw_error(NULL, "Cannot modify ICU4CIterator segments");
+}
+
+static void icu4c_iterator_unset_dimension(zend_object *object, zval *offset)
+{
+    zend_throw_error(NULL, "Cannot modify ICU4CIterator segments");
+}
+
+// Object destructor
+static void icu4c_iterator_free_object(zend_object *object)
+{
+    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(object);
+    
+    icu4c_iterator_release(obj);
+    
     zend_object_std_dtor(&obj->std);
 }
 
+// Clone handler: the copy shares the boundaries and keeps its own position
+static zend_object *icu4c_iterator_clone_object(zend_object *object)
+{
+    icu4c_iterator_obj *old_obj = icu4c_iterator_from_obj(object);
+    icu4c_iterator_obj *new_obj = icu4c_iterator_from_obj(icu4c_iterator_create_object(object->ce));
+    
+    zend_objects_clone_members(&new_obj->std, &old_obj->std);
+    
+    if (old_obj->text) {
+        new_obj->text = zend_string_copy(old_obj->text);
+        new_obj->index = icu4c_boundary_index_addref(old_obj->index);
+    }
+    
+    new_obj->flags = old_obj->flags;
+    new_obj->current_pos = old_obj->current_pos;
+    new_obj->from_last = old_obj->from_last;
+    new_obj->seek_index = old_obj->seek_index;
+    new_obj->seek_offset = old_obj->seek_offset;
+    new_obj->seek_overflow = old_obj->seek_overflow;
+    
+    return &new_obj->std;
+}
+
 // Count elements handler for Countable interface
 static zend_result icu4c_iterator_count_elements(zend_object *object, zend_long *count)
 {
     icu4c_iterator_obj *obj = icu4c_iterator_from_obj(object);
-    *count = obj->total_clusters;
+    *count = icu4c_iterator_count(obj);
     return SUCCESS;
 }
 
@@ -72,8 +890,8 @@ static zend_result icu4c_internal_iterator_valid(zend_object_iterator *iter)
 {
     icu4c_internal_iterator *iterator = (icu4c_internal_iterator*)iter;
     icu4c_iterator_obj *object = icu4c_iterator_from_obj(Z_OBJ(iter->data));
-
-    if (iterator->current_pos < object->total_clusters) {
+    
+    if (icu4c_iterator_fill(object, iterator->current_pos)) {
         return SUCCESS;
     }
     return FAILURE;
@@ -83,53 +901,21 @@ static zval *icu4c_internal_iterator_get_current(zend_object_iterator *iter)
 {
     icu4c_internal_iterator *iterator = (icu4c_internal_iterator*)iter;
     icu4c_iterator_obj *object = icu4c_iterator_from_obj(Z_OBJ(iter->data));
-
-    if (iterator->current_pos >= object->total_clusters) {
+    
+    if (!icu4c_iterator_fill(object, iterator->current_pos)) {
         return &EG(uninitialized_zval);
     }
-
-#ifdef HAVE_ICU4C
-    zend_string *cluster_str = icu4c_get_cluster_at_position(
-        ZSTR_VAL(object->text), 
-        ZSTR_LEN(object->text), 
-        object->cluster_boundaries, 
-        iterator->current_pos
-    );
-#else
-    // Fallback: return single UTF-8 character
-    const char *text = ZSTR_VAL(object->text);
-    size_t text_len = ZSTR_LEN(object->text);
-    size_t current_char = 0;
-    size_t pos = 0;
-    
-    while (pos < text_len && current_char < iterator->current_pos) {
-        if ((text[pos] & 0xC0) != 0x80) {
-            current_char++;
-        }
-        pos++;
-    }
     
-    if (pos < text_len) {
-        size_t char_len = 1;
-        while (pos + char_len < text_len && (text[pos + char_len] & 0xC0) == 0x80) {
-            char_len++;
-        }
-        zend_string *cluster_str = zend_string_init(text + pos, char_len, 0);
-    } else {
-        zend_string *cluster_str = NULL;
+    // Store the current value in the iterator structure
+    if (Z_TYPE(iterator->current_value) != IS_UNDEF) {
+        zval_ptr_dtor(&iterator->current_value);
     }
-#endif
-
-    if (cluster_str) {
-        // Store the current value in the iterator structure
-        if (Z_TYPE(iterator->current_value) != IS_UNDEF) {
-            zval_ptr_dtor(&iterator->current_value);
-        }
-        ZVAL_STR(&iterator->current_value, cluster_str);
-        return &iterator->current_value;
-    } else {
+    icu4c_iterator_get_value(object, iterator->current_pos, &iterator->current_value);
+    
+    if (Z_TYPE(iterator->current_value) == IS_NULL) {
         return &EG(uninitialized_zval);
     }
+    return &iterator->current_value;
 }
 
 static void icu4c_internal_iterator_get_key(zend_object_iterator *iter, zval *key)
@@ -162,16 +948,16 @@ static zend_object_iterator *icu4c_iterator_get_iterator(zend_class_entry *ce, z
         zend_throw_error(NULL, "An iterator cannot be used with foreach by reference");
         return NULL;
     }
-
+    
     // Create internal iterator that wraps our object and implements Iterator interface
     icu4c_internal_iterator *iterator = emalloc(sizeof(icu4c_internal_iterator));
     zend_iterator_init((zend_object_iterator*)iterator);
-
+    
     ZVAL_OBJ_COPY(&iterator->intern.data, Z_OBJ_P(object));
     iterator->intern.funcs = &icu4c_internal_iterator_funcs;
     iterator->current_pos = 0;
     ZVAL_UNDEF(&iterator->current_value);
-
+    
     return &iterator->intern;
 }
 
@@ -179,34 +965,29 @@ static zend_object_iterator *icu4c_iterator_get_iterator(zend_class_entry *ce, z
 PHP_METHOD(ICU4CIterator, __construct)
 {
     zend_string *text;
+    zend_long flags = 0;
+    zend_long mode = ICU4C_BREAK_GRAPHEME;
+    zend_string *locale = NULL;
     
-    ZEND_PARSE_PARAMETERS_START(1, 1)
+    ZEND_PARSE_PARAMETERS_START(1, 4)
         Z_PARAM_STR(text)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(flags)
+        Z_PARAM_LONG(mode)
+        Z_PARAM_STR_OR_NULL(locale)
     ZEND_PARSE_PARAMETERS_END();
     
+    if (!icu4c_iterator_check_args(flags, mode, 2)) {
+        RETURN_THROWS();
+    }
+    
     icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
     
-    // Initialize the iterator
-    obj->text = zend_string_copy(text);
-    obj->current_pos = 0;
-    obj->cluster_boundaries = NULL;
+    // Re-construction: drop any previous state
+    icu4c_iterator_release(obj);
     
-#ifdef HAVE_ICU4C
-    // Count grapheme clusters and build boundary array
-    obj->total_clusters = icu4c_count_grapheme_clusters(ZSTR_VAL(text), ZSTR_LEN(text), &obj->cluster_boundaries);
-#else
-    // Fallback: count UTF-8 characters
-    obj->total_clusters = 0;
-    const char *ptr = ZSTR_VAL(text);
-    const char *end = ptr + ZSTR_LEN(text);
-    
-    while (ptr < end) {
-        if ((*ptr & 0xC0) != 0x80) {
-            obj->total_clusters++;
-        }
-        ptr++;
-    }
-#endif
+    // Initialize the iterator; boundaries are computed on demand
+    icu4c_iterator_setup(obj, text, flags, mode, locale);
 }
 
 // ICU4CIterator::current method
@@ -216,47 +997,19 @@ PHP_METHOD(ICU4CIterator, current)
     
     icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
     
-    if (!obj->text || obj->current_pos >= obj->total_clusters) {
+    if (!obj->text || !icu4c_iterator_fill_current(obj)) {
         RETURN_NULL();
     }
     
-#ifdef HAVE_ICU4C
-    zend_string *cluster_str = icu4c_get_cluster_at_position(
-        ZSTR_VAL(obj->text), 
-        ZSTR_LEN(obj->text), 
-        obj->cluster_boundaries, 
-        obj->current_pos
-    );
-#else
-    // Fallback: return single UTF-8 character
-    const char *text = ZSTR_VAL(obj->text);
-    size_t text_len = ZSTR_LEN(obj->text);
-    size_t current_char = 0;
-    size_t pos = 0;
-    
-    while (pos < text_len && current_char < obj->current_pos) {
-        if ((text[pos] & 0xC0) != 0x80) {
-            current_char++;
-        }
-        pos++;
-    }
-    
-    if (pos < text_len) {
-        size_t char_len = 1;
-        while (pos + char_len < text_len && (text[pos + char_len] & 0xC0) == 0x80) {
-            char_len++;
-        }
-        zend_string *cluster_str = zend_string_init(text + pos, char_len, 0);
-    } else {
-        zend_string *cluster_str = NULL;
+    if (obj->from_last) {
+        size_t start, len;
+        
+        icu4c_iterator_span_from(obj, obj->current_pos, !(obj->flags & ICU4C_ITER_REVERSE), &start, &len);
+        icu4c_iterator_make_value(obj, start, len, return_value);
+        return;
     }
-#endif
     
-    if (cluster_str) {
-        RETURN_STR(cluster_str);
-    } else {
-        RETURN_NULL();
-    }
+    icu4c_iterator_get_value(obj, obj->current_pos, return_value);
 }
 
 // ICU4CIterator::key method
@@ -266,7 +1019,9 @@ PHP_METHOD(ICU4CIterator, key)
     
     icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
     
-    RETURN_LONG(obj->current_pos);
+    icu4c_iterator_resolve_position(obj);
+    
+    RETURN_LONG(obj->current_pos == ICU4C_POSITION_BEFORE_START ? -1 : (zend_long)obj->current_pos);
 }
 
 // ICU4CIterator::next method
@@ -276,11 +1031,67 @@ PHP_METHOD(ICU4CIterator, next)
     
     icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
     
-    if (obj->current_pos < obj->total_clusters) {
+    // Counting back from the last segment: one step towards it, and from
+    // the last one past the end
+    if (obj->from_last) {
+        if (obj->current_pos == 0) {
+            obj->current_pos = ICU4C_POSITION_BEFORE_START;
+        } else if (obj->current_pos != ICU4C_POSITION_BEFORE_START) {
+            obj->current_pos--;
+        }
+        return;
+    }
+    
+    if (obj->current_pos == ICU4C_POSITION_BEFORE_START) {
+        obj->current_pos = 0;
+    } else if (icu4c_iterator_fill(obj, obj->current_pos)) {
         obj->current_pos++;
     }
 }
 
+// ICU4CIterator::prev method
+PHP_METHOD(ICU4CIterator, prev)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    
+    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    // Counting back from the last segment: one step further back, segmenting
+    // from that end; from the first segment to before it
+    if (obj->from_last) {
+        if (obj->current_pos == ICU4C_POSITION_BEFORE_START) {
+            obj->current_pos = 0;
+        } else if (icu4c_iterator_fill_from(obj, obj->current_pos + 1, !(obj->flags & ICU4C_ITER_REVERSE))) {
+            obj->current_pos++;
+        } else {
+            obj->from_last = false;
+            obj->current_pos = ICU4C_POSITION_BEFORE_START;
+        }
+        return;
+    }
+    
+    // From the first segment to before it, where valid() is false; from
+    // past the end to the last segment
+    if (obj->current_pos == 0) {
+        obj->current_pos = ICU4C_POSITION_BEFORE_START;
+    } else if (obj->current_pos != ICU4C_POSITION_BEFORE_START) {
+        obj->current_pos--;
+    }
+}
+
+// ICU4CIterator::last method
+PHP_METHOD(ICU4CIterator, last)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    
+    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    // Segmented from the end of the text (its start in reverse mode) only
+    // as far as the iterator then moves back; key() needs the full count
+    obj->from_last = true;
+    obj->current_pos = 0;
+}
+
 // ICU4CIterator::rewind method
 PHP_METHOD(ICU4CIterator, rewind)
 {
@@ -288,6 +1099,7 @@ PHP_METHOD(ICU4CIterator, rewind)
     
     icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
     
+    obj->from_last = false;
     obj->current_pos = 0;
 }
 
@@ -298,7 +1110,7 @@ PHP_METHOD(ICU4CIterator, valid)
     
     icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
     
-    RETURN_BOOL(obj->text && obj->current_pos < obj->total_clusters);
+    RETURN_BOOL(obj->text && icu4c_iterator_fill_current(obj));
 }
 
 // ICU4CIterator::getIterator method  
@@ -306,7 +1118,8 @@ PHP_METHOD(ICU4CIterator, getIterator)
 {
     ZEND_PARSE_PARAMETERS_NONE();
     
-    // Return self since this class implements Iterator
+    // Return self since this class implements Iterator; foreach over it
+    // uses the same object, hence the same boundaries
     RETURN_ZVAL(ZEND_THIS, 1, 0);
 }
 
@@ -317,7 +1130,307 @@ PHP_METHOD(ICU4CIterator, count)
     
     icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
     
-    RETURN_LONG(obj->total_clusters);
+    RETURN_LONG(icu4c_iterator_count(obj));
+}
+
+// ICU4CIterator::boundaries method
+PHP_METHOD(ICU4CIterator, boundaries)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    
+    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    // All boundaries, including those of skipped segments
+    icu4c_iterator_count(obj);
+    size_t count = obj->index ? obj->index->total_clusters : 0;
+    
+    if (count == 0) {
+        RETURN_EMPTY_ARRAY();
+    }
+    
+    // Byte offsets of every boundary, from 0 to strlen($text)
+    array_init_size(return_value, (uint32_t)(count + 1));
+    zend_hash_real_init_packed(Z_ARRVAL_P(return_value));
+    
+    ZEND_HASH_FILL_PACKED(Z_ARRVAL_P(return_value)) {
+        int32_t offset = 0;
+        size_t overflow = 0;
+        
+        for (size_t i = 0; i < count; i++) {
+            ZEND_HASH_FILL_SET_LONG(offset);
+            ZEND_HASH_FILL_NEXT();
+            
+            uint8_t len = obj->index->cluster_lengths[i];
+            offset += len == ICU4C_LENGTH_ESCAPE ? (int32_t)obj->index->length_overflow[overflow++] : len;
+        }
+        ZEND_HASH_FILL_SET_LONG(offset);
+        ZEND_HASH_FILL_NEXT();
+    } ZEND_HASH_FILL_END();
+}
+
+// ICU4CIterator::packedBoundaries method
+PHP_METHOD(ICU4CIterator, packedBoundaries)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    
+    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    // All boundaries, including those of skipped segments
+    icu4c_iterator_count(obj);
+    size_t count = obj->index ? obj->index->total_clusters : 0;
+    
+    if (count == 0) {
+        RETURN_EMPTY_STRING();
+    }
+    
+    // Boundaries as int32s in machine byte order (unpack('l*', ...))
+    zend_string *packed = zend_string_safe_alloc(count + 1, sizeof(int32_t), 0, 0);
+    int32_t *out = (int32_t *)ZSTR_VAL(packed);
+    
+    int32_t offset = 0;
+    size_t overflow = 0;
+    
+    for (size_t i = 0; i < count; i++) {
+        uint8_t len = obj->index->cluster_lengths[i];
+        
+        *out++ = offset;
+        offset += len == ICU4C_LENGTH_ESCAPE ? (int32_t)obj->index->length_overflow[overflow++] : len;
+    }
+    *out = offset;
+    ZSTR_VAL(packed)[ZSTR_LEN(packed)] = '\0';
+    
+    RETURN_NEW_STR(packed);
+}
+
+// ICU4CIterator::offsetExists method
+PHP_METHOD(ICU4CIterator, offsetExists)
+{
+    zval *offset;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    RETURN_BOOL(icu4c_iterator_has_dimension(Z_OBJ_P(ZEND_THIS), offset, 0));
+}
+
+// ICU4CIterator::offsetGet method
+PHP_METHOD(ICU4CIterator, offsetGet)
+{
+    zval *offset;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    zval *value = icu4c_iterator_read_dimension(Z_OBJ_P(ZEND_THIS), offset, BP_VAR_R, return_value);
+    if (value != return_value) {
+        RETURN_NULL();
+    }
+}
+
+// ICU4CIterator::offsetSet method
+PHP_METHOD(ICU4CIterator, offsetSet)
+{
+    zval *offset, *value;
+    
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_ZVAL(offset)
+        Z_PARAM_ZVAL(value)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    icu4c_iterator_write_dimension(Z_OBJ_P(ZEND_THIS), offset, value);
+}
+
+// ICU4CIterator::offsetUnset method
+PHP_METHOD(ICU4CIterator, offsetUnset)
+{
+    zval *offset;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ZVAL(offset)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    icu4c_iterator_unset_dimension(Z_OBJ_P(ZEND_THIS), offset);
+}
+
+// ICU4CIterator::seek method
+PHP_METHOD(ICU4CIterator, seek)
+{
+    zend_long offset;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_LONG(offset)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    if (!icu4c_iterator_has(obj, offset)) {
+        zend_throw_exception_ex(spl_ce_OutOfBoundsException, 0, "Seek position " ZEND_LONG_FMT " is out of range", offset);
+        RETURN_THROWS();
+    }
+    
+    obj->from_last = false;
+    obj->current_pos = (size_t)offset;
+}
+
+// ICU4CIterator::slice method
+PHP_METHOD(ICU4CIterator, slice)
+{
+    zend_long start;
+    zend_long length = 0;
+    bool length_is_null = true;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_LONG(start)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG_OR_NULL(length, length_is_null)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    if (!obj->text) {
+        RETURN_EMPTY_STRING();
+    }
+    
+    // Negative positions count from the end, as in substr(); only they
+    // (and an omitted length) require segmenting the whole text
+    zend_long count = (start < 0 || length_is_null || length < 0)
+        ? (zend_long)icu4c_iterator_count(obj) : ZEND_LONG_MAX;
+    
+    if (start < 0) {
+        start = MAX(count + start, 0);
+    }
+    
+    zend_long end = length_is_null ? count
+        : length < 0 ? count + length
+        : (length > ZEND_LONG_MAX - start ? ZEND_LONG_MAX : start + length);
+    
+    if (end <= start || !icu4c_iterator_has(obj, start)) {
+        RETURN_EMPTY_STRING();
+    }
+    
+    // Clamp to the segments that exist
+    if (!icu4c_iterator_has(obj, end - 1)) {
+        end = (zend_long)icu4c_iterator_count(obj);
+    }
+    
+    size_t first_start, first_len, last_start, last_len;
+    
+    icu4c_iterator_span(obj, (size_t)(end - 1), &last_start, &last_len);
+    icu4c_iterator_span(obj, (size_t)start, &first_start, &first_len);
+    
+    // One copy between the two boundaries; in reverse mode the text runs
+    // from the last segment to the first
+    if (obj->flags & ICU4C_ITER_REVERSE) {
+        RETURN_STRINGL(ZSTR_VAL(obj->text) + last_start, first_start + first_len - last_start);
+    }
+    RETURN_STRINGL(ZSTR_VAL(obj->text) + first_start, last_start + last_len - first_start);
+}
+
+// ICU4CIterator::__serialize method
+PHP_METHOD(ICU4CIterator, __serialize)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    
+    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    if (!obj->text) {
+        RETURN_EMPTY_ARRAY();
+    }
+    
+    // Segment the whole text so that the boundaries travel with it
+    icu4c_iterator_count(obj);
+    icu4c_iterator_resolve_position(obj);
+    
+    const icu4c_boundary_index *index = obj->index;
+    char version[64];
+    
+    icu4c_segmentation_version(version, sizeof(version));
+    
+    array_init_size(return_value, 7);
+    add_assoc_str(return_value, "text", zend_string_copy(obj->text));
+    add_assoc_long(return_value, "flags", obj->flags);
+    add_assoc_long(return_value, "mode", index->mode);
+    if (index->locale) {
+        add_assoc_str(return_value, "locale", zend_string_copy(index->locale));
+    } else {
+        add_assoc_null(return_value, "locale");
+    }
+    add_assoc_long(return_value, "position",
+        obj->current_pos == ICU4C_POSITION_BEFORE_START ? -1 : (zend_long)obj->current_pos);
+    add_assoc_string(return_value, "version", version);
+    if (index->cursor.failed || index->total_clusters > UINT32_MAX) {
+        add_assoc_null(return_value, "boundaries");
+    } else {
+        add_assoc_str(return_value, "boundaries", icu4c_boundary_index_dump(index));
+    }
+}
+
+// ICU4CIterator::__unserialize method
+PHP_METHOD(ICU4CIterator, __unserialize)
+{
+    HashTable *data;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_ARRAY_HT(data)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    icu4c_iterator_obj *obj = icu4c_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    // An iterator serialized before construction stays unconstructed
+    if (zend_hash_num_elements(data) == 0) {
+        icu4c_iterator_release(obj);
+        return;
+    }
+    
+    zval *text = zend_hash_str_find(data, "text", sizeof("text") - 1);
+    zval *flags = zend_hash_str_find(data, "flags", sizeof("flags") - 1);
+    zval *mode = zend_hash_str_find(data, "mode", sizeof("mode") - 1);
+    zval *locale = zend_hash_str_find(data, "locale", sizeof("locale") - 1);
+    zval *position = zend_hash_str_find(data, "position", sizeof("position") - 1);
+    zval *version = zend_hash_str_find(data, "version", sizeof("version") - 1);
+    zval *boundaries = zend_hash_str_find(data, "boundaries", sizeof("boundaries") - 1);
+    
+    if (!text || Z_TYPE_P(text) != IS_STRING || !flags || Z_TYPE_P(flags) != IS_LONG
+        || !mode || Z_TYPE_P(mode) != IS_LONG || (locale && Z_TYPE_P(locale) != IS_STRING && Z_TYPE_P(locale) != IS_NULL)
+        || (position && (Z_TYPE_P(position) != IS_LONG || Z_LVAL_P(position) < -1))
+        || (Z_LVAL_P(flags) & ~ICU4C_ITER_FLAGS_MASK)
+        || Z_LVAL_P(mode) < ICU4C_BREAK_GRAPHEME || Z_LVAL_P(mode) > ICU4C_BREAK_SENTENCE
+        || ((Z_LVAL_P(flags) & ICU4C_ITER_SKIP_NONWORDS) && Z_LVAL_P(mode) != ICU4C_BREAK_WORD)) {
+        zend_throw_exception(spl_ce_UnexpectedValueException, "Invalid serialization data for ICU4CIterator object", 0);
+        RETURN_THROWS();
+    }
+    
+    zend_string *locale_str = locale && Z_TYPE_P(locale) == IS_STRING ? Z_STR_P(locale) : NULL;
+    bool words_only = (Z_LVAL_P(flags) & ICU4C_ITER_SKIP_NONWORDS) != 0;
+    char current_version[64];
+    
+    icu4c_segmentation_version(current_version, sizeof(current_version));
+    icu4c_iterator_release(obj);
+    
+    // Boundaries computed by the same rules are trusted as they are; any
+    // other version (or a damaged block) segments the text again, lazily
+    icu4c_boundary_index *index = NULL;
+    
+    if (version && Z_TYPE_P(version) == IS_STRING && Z_STRLEN_P(version) == strlen(current_version)
+        && memcmp(Z_STRVAL_P(version), current_version, Z_STRLEN_P(version)) == 0
+        && boundaries && Z_TYPE_P(boundaries) == IS_STRING) {
+        index = icu4c_boundary_index_load(Z_STR_P(text), Z_LVAL_P(mode), words_only, locale_str, Z_STR_P(boundaries));
+    }
+    
+    if (index) {
+        obj->text = zend_string_copy(Z_STR_P(text));
+        obj->index = index;
+        obj->flags = Z_LVAL_P(flags);
+        ICU4C_G(stats).iterators_created++;
+    } else {
+        icu4c_iterator_setup(obj, Z_STR_P(text), Z_LVAL_P(flags), Z_LVAL_P(mode), locale_str);
+    }
+    
+    obj->from_last = false;
+    obj->current_pos = !position ? 0
+        : Z_LVAL_P(position) < 0 ? ICU4C_POSITION_BEFORE_START : (size_t)Z_LVAL_P(position);
 }
 
 // Method entries for ICU4CIterator class
@@ -326,10 +1439,22 @@ static const zend_function_entry icu4c_iterator_methods[] = {
     PHP_ME(ICU4CIterator, current, arginfo_icu4c_iterator_current, ZEND_ACC_PUBLIC)
     PHP_ME(ICU4CIterator, key, arginfo_icu4c_iterator_key, ZEND_ACC_PUBLIC)
     PHP_ME(ICU4CIterator, next, arginfo_icu4c_iterator_next, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, prev, arginfo_icu4c_iterator_prev, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, last, arginfo_icu4c_iterator_last, ZEND_ACC_PUBLIC)
     PHP_ME(ICU4CIterator, rewind, arginfo_icu4c_iterator_rewind, ZEND_ACC_PUBLIC)
     PHP_ME(ICU4CIterator, valid, arginfo_icu4c_iterator_valid, ZEND_ACC_PUBLIC)
     PHP_ME(ICU4CIterator, getIterator, arginfo_icu4c_iterator_getiterator, ZEND_ACC_PUBLIC)
     PHP_ME(ICU4CIterator, count, arginfo_icu4c_iterator_count, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, boundaries, arginfo_icu4c_iterator_boundaries, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, packedBoundaries, arginfo_icu4c_iterator_packedboundaries, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, offsetExists, arginfo_icu4c_iterator_offsetexists, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, offsetGet, arginfo_icu4c_iterator_offsetget, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, offsetSet, arginfo_icu4c_iterator_offsetset, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, offsetUnset, arginfo_icu4c_iterator_offsetunset, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, seek, arginfo_icu4c_iterator_seek, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, slice, arginfo_icu4c_iterator_slice, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, __serialize, arginfo_icu4c_iterator_serialize, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CIterator, __unserialize, arginfo_icu4c_iterator_unserialize, ZEND_ACC_PUBLIC)
     PHP_FE_END
 };
 
@@ -344,12 +1469,17 @@ void icu4c_iterator_init(void)
     // Set up object handlers
     memcpy(&icu4c_iterator_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
     icu4c_iterator_handlers.free_obj = icu4c_iterator_free_object;
+    icu4c_iterator_handlers.clone_obj = icu4c_iterator_clone_object;
     icu4c_iterator_handlers.offset = XtOffsetOf(icu4c_iterator_obj, std);
     icu4c_iterator_handlers.count_elements = icu4c_iterator_count_elements;
+    icu4c_iterator_handlers.read_dimension = icu4c_iterator_read_dimension;
+    icu4c_iterator_handlers.has_dimension = icu4c_iterator_has_dimension;
+    icu4c_iterator_handlers.write_dimension = icu4c_iterator_write_dimension;
+    icu4c_iterator_handlers.unset_dimension = icu4c_iterator_unset_dimension;
     
     // Set get_iterator handler for IteratorAggregate
     icu4c_iterator_ce->get_iterator = icu4c_iterator_get_iterator;
     
-    // Implement IteratorAggregate and Countable interfaces
-    zend_class_implements(icu4c_iterator_ce, 2, zend_ce_aggregate, zend_ce_countable);
+    // Implement IteratorAggregate, Countable and ArrayAccess interfaces
+    zend_class_implements(icu4c_iterator_ce, 3, zend_ce_aggregate, zend_ce_countable, zend_ce_arrayaccess);
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "php_icu4c.h"
+
+#if defined(HAVE_ICU4C) && defined(HAVE_ICU4C_THREADS)
+#include <pthread.h>
+#include <unicode/uchar.h>
+
+// Bytes scanned past a chunk's nominal end for a safe split point
+#define ICU4C_PARALLEL_SPLIT_WINDOW   4096
+
+// One chunk of the text, segmented by one worker thread. Workers only use
+// their own break iterator and malloc(), never the Zend allocator or globals.
+typedef struct _icu4c_parallel_chunk {
+    const char *text;            // Start of the chunk (not owned)
+    int32_t len;                 // Chunk length in bytes
+    int32_t start;               // Offset of the chunk in the whole text
+    UBreakIterator *break_iter;  // Private to the worker
+    int32_t *boundaries;         // Boundaries after the chunk start, relative to it (malloc'd)
+    size_t count;                // Entries used in boundaries
+    size_t capacity;             // Allocated entries in boundaries
+    pthread_t thread;
+    bool started;                // thread was created (else the chunk ran inline)
+    bool failed;                 // ICU4C or malloc() failed
+} icu4c_parallel_chunk;
+
+// Grapheme_Cluster_Break value of the code point at s[*i], advancing *i; -1
+// for ill-formed UTF-8
+static zend_always_inline int32_t icu4c_parallel_gcb(const uint8_t *s, int32_t *i, int32_t len)
+{
+    UChar32 c;
+    
+    U8_NEXT(s, *i, len, c);
+    return c < 0 ? -1 : u_getIntPropertyValue(c, UCHAR_GRAPHEME_CLUSTER_BREAK);
+}
+
+// First position at or after pos where UAX #29 puts a boundary whatever
+// the surrounding text: the previous code point is Other, Control or LF
+// (GB4, GB999) and the next one is Other, so no rule that looks further
+// back (GB9c, GB11, GB12/13) applies across it. 0 if none is near.
+static int32_t icu4c_parallel_split(const char *text, int32_t len, int32_t pos)
+{
+    const uint8_t *s = (const uint8_t *)text;
+    int32_t limit = (int32_t)MIN((int64_t)len, (int64_t)pos + ICU4C_PARALLEL_SPLIT_WINDOW);
+    
+    // Start on a code point
+    while (pos < limit && U8_IS_TRAIL(s[pos])) {
+        pos++;
+    }
+    
+    if (pos <= 0 || pos >= limit) {
+        return 0;
+    }
+    
+    int32_t i = pos;
+    UChar32 c;
+    U8_PREV(s, 0, i, c);
+    int32_t prev = c < 0 ? -1 : u_getIntPropertyValue(c, UCHAR_GRAPHEME_CLUSTER_BREAK);
+    
+    for (i = pos; i < limit; ) {
+        int32_t at = i;
+        int32_t next = icu4c_parallel_gcb(s, &i, len);
+        
+        if (next == U_GCB_OTHER && (prev == U_GCB_OTHER || prev == U_GCB_CONTROL || prev == U_GCB_LF)) {
+            return at;
+        }
+        prev = next;
+    }
+    
+    return 0;
+}
+
+// Worker: all boundaries of one chunk
+static void *icu4c_parallel_worker(void *arg)
+{
+    icu4c_parallel_chunk *chunk = arg;
+    UErrorCode status = U_ZERO_ERROR;
+    UText *ut = utext_openUTF8(NULL, chunk->text, chunk->len, &status);
+    
+    ubrk_setUText(chunk->break_iter, ut, &status);
+    
+    if (U_FAILURE(status)) {
+        chunk->failed = true;
+        utext_close(ut);
+        return NULL;
+    }
+    
+    // About one cluster per two bytes to start with
+    chunk->capacity = (size_t)chunk->len / 2 + 16;
+    chunk->boundaries = malloc(chunk->capacity * sizeof(int32_t));
+    
+    int32_t boundary;
+    while (chunk->boundaries && (boundary = ubrk_next(chunk->break_iter)) != UBRK_DONE) {
+        if (chunk->count >= chunk->capacity) {
+            int32_t *grown = realloc(chunk->boundaries, chunk->capacity * 2 * sizeof(int32_t));
+            if (!grown) {
+                break;
+            }
+            chunk->boundaries = grown;
+            chunk->capacity *= 2;
+        }
+        chunk->boundaries[chunk->count++] = boundary;
+    }
+    
+    chunk->failed = !chunk->boundaries || chunk->count == 0 || chunk->boundaries[chunk->count - 1] != chunk->len;
+    
+    utext_close(ut);
+    return NULL;
+}
+
+// Find the grapheme cluster boundaries of text on icu4c.parallel_threads
+// threads and pass them to emit in order (excluding 0, ending with len).
+// Returns false without calling emit when parallel mode is off, the text
+// is too short or cannot be split, or a worker failed; the caller then
+// segments sequentially.
+bool icu4c_parallel_segment(const char *text, size_t len, icu4c_parallel_emit emit, void *ctx)
+{
+    zend_long threads = MIN(ICU4C_G(parallel_threads), ICU4C_PARALLEL_MAX_THREADS);
+    
+    if (threads < 2 || len < (size_t)MAX(ICU4C_G(parallel_min_size), 1) || len > INT32_MAX) {
+        return false;
+    }
+    
+    icu4c_parallel_chunk chunks[ICU4C_PARALLEL_MAX_THREADS];
+    size_t count = 0;
+    int32_t start = 0;
+    
+    memset(chunks, 0, sizeof(chunks));
+    
+    // Nominal chunk ends, each moved forward to the next safe split point
+    for (zend_long t = 1; t <= threads; t++) {
+        int32_t end = t == threads ? (int32_t)len
+            : icu4c_parallel_split(text, (int32_t)len, (int32_t)((int64_t)len * t / threads));
+        
+        if (end > start) {
+            chunks[count].text = text + start;
+            chunks[count].start = start;
+            chunks[count].len = end - start;
+            count++;
+            start = end;
+        }
+    }
+    
+    if (count < 2) {
+        return false;
+    }
+    
+    ICU4C_TIMER_START(timer);
+    bool ok = true;
+    
+    // Break iterators come from the pool on this thread: the prototype for
+    // the first chunk and clones for the others
+    for (size_t i = 0; i < count; i++) {
+        UErrorCode status = U_ZERO_ERROR;
+        chunks[i].break_iter = icu4c_break_iter_acquire(UBRK_CHARACTER, NULL, &status);
+        ok = ok && chunks[i].break_iter && U_SUCCESS(status);
+    }
+    
+    if (ok) {
+        for (size_t i = 0; i < count; i++) {
+            chunks[i].started = pthread_create(&chunks[i].thread, NULL, icu4c_parallel_worker, &chunks[i]) == 0;
+        }
+        
+        for (size_t i = 0; i < count; i++) {
+            if (chunks[i].started) {
+                pthread_join(chunks[i].thread, NULL);
+            } else {
+                // No thread available: do the chunk here
+                icu4c_parallel_worker(&chunks[i]);
+            }
+        }
+        
+        for (size_t i = 0; i < count; i++) {
+            ok = ok && !chunks[i].failed;
+        }
+    }
+    
+    if (ok) {
+        size_t segments = 0;
+        
+        for (size_t i = 0; i < count; i++) {
+            for (size_t j = 0; j < chunks[i].count; j++) {
+                emit(ctx, chunks[i].start + chunks[i].boundaries[j]);
+            }
+            segments += chunks[i].count;
+        }
+        
+        ICU4C_G(stats).parallel_segmentations++;
+        ICU4C_G(stats).segments += segments;
+        ICU4C_G(stats).bytes_segmented += len;
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        if (chunks[i].break_iter) {
+            icu4c_break_iter_release(chunks[i].break_iter);
+        }
+        free(chunks[i].boundaries);
+    }
+    
+    ICU4C_TIMER_STOP(timer, segmentation_ns);
+    return ok;
+}
+#else
+// Parallel segmentation needs ICU4C and native threads
+bool icu4c_parallel_segment(const char *text, size_t len, icu4c_parallel_emit emit, void *ctx)
+{
+    return false;
+}
+#endif
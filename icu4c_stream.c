@@ -0,0 +1,437 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "zend_exceptions.h"
+#include "ext/spl/spl_exceptions.h"
+#include "php_icu4c.h"
+
+// Object handlers
+static zend_object_handlers icu4c_stream_iterator_handlers;
+
+// Object creation function
+static zend_object *icu4c_stream_iterator_create_object(zend_class_entry *ce)
+{
+    icu4c_stream_iterator_obj *obj = zend_object_alloc(sizeof(icu4c_stream_iterator_obj), ce);
+    
+    zend_object_std_init(&obj->std, ce);
+    object_properties_init(&obj->std, ce);
+    
+    obj->std.handlers = &icu4c_stream_iterator_handlers;
+    
+    // Initialize fields
+    ZVAL_UNDEF(&obj->stream);
+    obj->file = NULL;
+    obj->mapping = NULL;
+    obj->mapping_len = 0;
+    obj->flags = 0;
+    obj->chunk_size = ICU4C_STREAM_CHUNK_SIZE;
+    obj->buffer = NULL;
+    obj->buffer_len = 0;
+    obj->buffer_capacity = 0;
+    obj->buffer_offset = 0;
+    obj->scan_len = 0;
+    icu4c_break_cursor_open(&obj->cursor, NULL, 0, UBRK_CHARACTER, NULL);
+    obj->cluster_start = 0;
+    obj->cluster_end = 0;
+    obj->key = 0;
+    obj->started = false;
+    obj->eof = true;
+    
+    return &obj->std;
+}
+
+// Release the stream, buffer and ICU4C resources of a stream iterator
+static void icu4c_stream_iterator_release(icu4c_stream_iterator_obj *obj)
+{
+    icu4c_break_cursor_close(&obj->cursor);
+    obj->cursor.text = NULL;
+    
+    zval_ptr_dtor(&obj->stream);
+    ZVAL_UNDEF(&obj->stream);
+    
+    if (obj->mapping) {
+        // The buffer points into the mapping
+        php_stream_mmap_unmap(obj->file);
+        obj->mapping = NULL;
+        obj->buffer = NULL;
+    }
+    
+    if (obj->file) {
+        php_stream_close(obj->file);
+        obj->file = NULL;
+    }
+    
+    if (obj->buffer) {
+        efree(obj->buffer);
+        obj->buffer = NULL;
+    }
+    obj->buffer_len = 0;
+    obj->buffer_capacity = 0;
+}
+
+// Byte length of text that may be segmented before more input arrives:
+// a truncated UTF-8 sequence at the end must wait for the next chunk
+static size_t icu4c_stream_complete_len(const char *buffer, size_t len)
+{
+    for (size_t back = 1; back <= 3 && back <= len; back++) {
+        unsigned char c = (unsigned char)buffer[len - back];
+        
+        if ((c & 0xC0) == 0x80) {
+            continue;
+        }
+        
+        size_t need = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+        return need > back ? len - back : len;
+    }
+    
+    return len;
+}
+
+// Drop consumed text, append the next chunk and rebind the cursor.
+// Returns false when there is nothing left to segment, or nothing yet
+// (eof stays false).
+static bool icu4c_stream_iterator_refill(icu4c_stream_iterator_obj *obj)
+{
+    php_stream *stream = obj->file;
+    
+    icu4c_break_cursor_close(&obj->cursor);
+    obj->cursor.text = NULL;
+    
+    // Carry the unfinished trailing cluster over to the front of the buffer
+    if (obj->cluster_start > 0) {
+        obj->buffer_len -= obj->cluster_start;
+        if (obj->mapping) {
+            obj->buffer += obj->cluster_start;
+        } else {
+            memmove(obj->buffer, obj->buffer + obj->cluster_start, obj->buffer_len);
+        }
+        obj->buffer_offset += obj->cluster_start;
+        obj->cluster_start = 0;
+    }
+    obj->cluster_end = 0;
+    
+    if (!stream && Z_TYPE(obj->stream) == IS_RESOURCE) {
+        php_stream_from_zval_no_verify(stream, &obj->stream);
+    }
+    
+    if (obj->mapping) {
+        // Widen the window over the mapping by one chunk; nothing is copied
+        size_t remaining = obj->mapping_len - obj->buffer_offset - obj->buffer_len;
+        
+        obj->buffer_len += MIN(remaining, obj->chunk_size);
+        obj->eof = obj->buffer_offset + obj->buffer_len == obj->mapping_len;
+    } else if (!stream) {
+        // Stream was closed during iteration: flush what is buffered
+        obj->eof = true;
+    } else {
+        if (obj->buffer_len + obj->chunk_size > obj->buffer_capacity) {
+            obj->buffer_capacity = obj->buffer_len + obj->chunk_size;
+            obj->buffer = erealloc(obj->buffer, obj->buffer_capacity);
+            ICU4C_G(stats).boundary_reallocs++;
+        }
+        
+        ssize_t got = php_stream_read(stream, obj->buffer + obj->buffer_len, obj->chunk_size);
+        
+        if (got > 0) {
+            obj->buffer_len += got;
+        } else if (got == 0 && !php_stream_eof(stream)) {
+            // No data yet (non-blocking socket or pipe): keep the buffer
+            // and read again on the next call
+            return false;
+        }
+        if (got < 0 || php_stream_eof(stream)) {
+            obj->eof = true;
+        }
+    }
+    
+    if (obj->buffer_len == 0) {
+        return false;
+    }
+    
+    obj->scan_len = obj->eof ? obj->buffer_len : icu4c_stream_complete_len(obj->buffer, obj->buffer_len);
+    
+    icu4c_break_cursor_open(&obj->cursor, obj->buffer, obj->scan_len, UBRK_CHARACTER, NULL);
+    if (obj->cursor.failed) {
+        // A single cluster outgrew int32_t offsets; give up on the rest
+        obj->eof = true;
+        return false;
+    }
+    
+    return true;
+}
+
+// Move to the next cluster; returns false at the end of the stream
+static bool icu4c_stream_iterator_advance(icu4c_stream_iterator_obj *obj)
+{
+    ICU4C_TIMER_START(timer);
+    obj->cluster_start = obj->cluster_end;
+    
+    for (;;) {
+        if (obj->cursor.text) {
+            int32_t boundary = icu4c_break_cursor_next(&obj->cursor);
+            
+            // The boundary at the end of a chunk is provisional until the
+            // next code point is known; anything before it is final
+            if (boundary != UBRK_DONE && (obj->eof || (size_t)boundary < obj->scan_len)) {
+                obj->cluster_end = boundary;
+                ICU4C_TIMER_STOP(timer, segmentation_ns);
+                return true;
+            }
+            
+            if (obj->eof) {
+                break;
+            }
+        } else if (obj->eof) {
+            break;
+        }
+        
+        if (!icu4c_stream_iterator_refill(obj)) {
+            break;
+        }
+    }
+    
+    // End of stream: no current cluster
+    icu4c_break_cursor_close(&obj->cursor);
+    obj->cursor.text = NULL;
+    obj->cluster_start = obj->cluster_end;
+    ICU4C_TIMER_STOP(timer, segmentation_ns);
+    return false;
+}
+
+// Whether the stream iterator has a current cluster
+static zend_always_inline bool icu4c_stream_iterator_has_current(const icu4c_stream_iterator_obj *obj)
+{
+    return obj->cluster_end > obj->cluster_start;
+}
+
+// Read the first cluster on first use, or retry a read that found no data
+// yet on a non-blocking stream
+static zend_always_inline void icu4c_stream_iterator_start(icu4c_stream_iterator_obj *obj)
+{
+    if (!obj->started) {
+        ICU4C_COUNT_FALLBACK();
+    }
+    if (!obj->started || (!obj->eof && !icu4c_stream_iterator_has_current(obj))) {
+        icu4c_stream_iterator_advance(obj);
+        obj->started = true;
+    }
+}
+
+// Attach a stream to an iterator; nothing is read until the first cluster is needed
+void icu4c_stream_iterator_setup(icu4c_stream_iterator_obj *obj, zval *stream, zend_long flags, zend_long chunk_size)
+{
+    ZVAL_COPY(&obj->stream, stream);
+    obj->flags = flags;
+    obj->chunk_size = (size_t)chunk_size;
+    obj->buffer_offset = 0;
+    obj->scan_len = 0;
+    obj->cluster_start = 0;
+    obj->cluster_end = 0;
+    obj->key = 0;
+    obj->started = false;
+    obj->eof = false;
+    ICU4C_G(stats).iterators_created++;
+}
+
+// Open and map a file for segmentation; falls back to chunked reads
+// when the stream wrapper cannot map it. Returns false if it cannot be opened.
+bool icu4c_stream_iterator_open_file(icu4c_stream_iterator_obj *obj, zend_string *filename, zend_long flags)
+{
+    php_stream *stream = php_stream_open_wrapper(ZSTR_VAL(filename), "rb", REPORT_ERRORS, NULL);
+    
+    if (!stream) {
+        return false;
+    }
+    
+    obj->file = stream;
+    obj->flags = flags;
+    obj->chunk_size = ICU4C_STREAM_CHUNK_SIZE;
+    obj->buffer_offset = 0;
+    obj->scan_len = 0;
+    obj->cluster_start = 0;
+    obj->cluster_end = 0;
+    obj->key = 0;
+    obj->started = false;
+    obj->eof = false;
+    ICU4C_G(stats).iterators_created++;
+    
+    if (php_stream_mmap_possible(stream)) {
+        size_t mapped_len = 0;
+        char *mapping = php_stream_mmap_range(stream, 0, PHP_STREAM_MMAP_ALL, PHP_STREAM_MAP_MODE_SHARED_READONLY, &mapped_len);
+        
+        if (mapping) {
+            // Windows are only bounded by the int32_t offsets of the cursor
+            obj->mapping = mapping;
+            obj->mapping_len = mapped_len;
+            obj->buffer = mapping;
+            obj->chunk_size = ICU4C_STREAM_MAX_CHUNK_SIZE;
+        }
+    }
+    
+    return true;
+}
+
+// Validate icu4c_iter_stream() / ICU4CStreamIterator flags and chunk size arguments
+bool icu4c_stream_iterator_check_args(zend_long flags, zend_long chunk_size, uint32_t arg_num)
+{
+    if (flags & ~ICU4C_ITER_OFFSETS) {
+        zend_argument_value_error(arg_num, "must be 0 or ICU4C_ITER_OFFSETS");
+        return false;
+    }
+    
+    if (chunk_size < 1 || chunk_size > ICU4C_STREAM_MAX_CHUNK_SIZE) {
+        zend_argument_value_error(arg_num + 1, "must be between 1 and %d", ICU4C_STREAM_MAX_CHUNK_SIZE);
+        return false;
+    }
+    
+    return true;
+}
+
+// Object destructor
+static void icu4c_stream_iterator_free_object(zend_object *object)
+{
+    icu4c_stream_iterator_obj *obj = icu4c_stream_iterator_from_obj(object);
+    
+    icu4c_stream_iterator_release(obj);
+    
+    zend_object_std_dtor(&obj->std);
+}
+
+// ICU4CStreamIterator::__construct method
+PHP_METHOD(ICU4CStreamIterator, __construct)
+{
+    zval *zstream;
+    zend_long flags = 0;
+    zend_long chunk_size = ICU4C_STREAM_CHUNK_SIZE;
+    php_stream *stream;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 3)
+        Z_PARAM_RESOURCE(zstream)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(flags)
+        Z_PARAM_LONG(chunk_size)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    php_stream_from_zval(stream, zstream);
+    
+    if (!icu4c_stream_iterator_check_args(flags, chunk_size, 2)) {
+        RETURN_THROWS();
+    }
+    
+    icu4c_stream_iterator_obj *obj = icu4c_stream_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    // Re-construction: drop any previous state
+    icu4c_stream_iterator_release(obj);
+    
+    icu4c_stream_iterator_setup(obj, zstream, flags, chunk_size);
+}
+
+// ICU4CStreamIterator::current method
+PHP_METHOD(ICU4CStreamIterator, current)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    
+    icu4c_stream_iterator_obj *obj = icu4c_stream_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    icu4c_stream_iterator_start(obj);
+    if (!icu4c_stream_iterator_has_current(obj)) {
+        RETURN_NULL();
+    }
+    
+    size_t len = obj->cluster_end - obj->cluster_start;
+    
+    if (obj->flags & ICU4C_ITER_OFFSETS) {
+        // Offsets are relative to the start of the stream, so 64-bit
+        array_init_size(return_value, 2);
+        add_next_index_long(return_value, (zend_long)(obj->buffer_offset + obj->cluster_start));
+        add_next_index_long(return_value, (zend_long)len);
+        return;
+    }
+    
+    if (len == 1) {
+        RETURN_CHAR((zend_uchar)obj->buffer[obj->cluster_start]);
+    }
+    RETURN_STRINGL(obj->buffer + obj->cluster_start, len);
+}
+
+// ICU4CStreamIterator::key method
+PHP_METHOD(ICU4CStreamIterator, key)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    
+    icu4c_stream_iterator_obj *obj = icu4c_stream_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    RETURN_LONG(obj->key);
+}
+
+// ICU4CStreamIterator::next method
+PHP_METHOD(ICU4CStreamIterator, next)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    
+    icu4c_stream_iterator_obj *obj = icu4c_stream_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    icu4c_stream_iterator_start(obj);
+    if (icu4c_stream_iterator_has_current(obj)) {
+        obj->key++;
+        icu4c_stream_iterator_advance(obj);
+    }
+}
+
+// ICU4CStreamIterator::rewind method
+PHP_METHOD(ICU4CStreamIterator, rewind)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    
+    icu4c_stream_iterator_obj *obj = icu4c_stream_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    // Consumed input is not kept, so only a fresh iterator can be rewound
+    if (obj->key > 0) {
+        zend_throw_exception(spl_ce_LogicException, "Cannot rewind an ICU4CStreamIterator that has already advanced", 0);
+        RETURN_THROWS();
+    }
+    
+    icu4c_stream_iterator_start(obj);
+}
+
+// ICU4CStreamIterator::valid method
+PHP_METHOD(ICU4CStreamIterator, valid)
+{
+    ZEND_PARSE_PARAMETERS_NONE();
+    
+    icu4c_stream_iterator_obj *obj = icu4c_stream_iterator_from_obj(Z_OBJ_P(ZEND_THIS));
+    
+    icu4c_stream_iterator_start(obj);
+    RETURN_BOOL(icu4c_stream_iterator_has_current(obj));
+}
+
+// Method entries for ICU4CStreamIterator class
+static const zend_function_entry icu4c_stream_iterator_methods[] = {
+    PHP_ME(ICU4CStreamIterator, __construct, arginfo_icu4c_stream_iterator_construct, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CStreamIterator, current, arginfo_icu4c_iterator_current, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CStreamIterator, key, arginfo_icu4c_iterator_key, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CStreamIterator, next, arginfo_icu4c_iterator_next, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CStreamIterator, rewind, arginfo_icu4c_iterator_rewind, ZEND_ACC_PUBLIC)
+    PHP_ME(ICU4CStreamIterator, valid, arginfo_icu4c_iterator_valid, ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+// Initialize ICU4CStreamIterator class
+void icu4c_stream_iterator_init(void)
+{
+    zend_class_entry ce;
+    INIT_CLASS_ENTRY(ce, "ICU4CStreamIterator", icu4c_stream_iterator_methods);
+    icu4c_stream_iterator_ce = zend_register_internal_class(&ce);
+    icu4c_stream_iterator_ce->create_object = icu4c_stream_iterator_create_object;
+    icu4c_stream_iterator_ce->ce_flags |= ZEND_ACC_FINAL;
+    
+    // Set up object handlers; a half-read stream cannot be cloned
+    memcpy(&icu4c_stream_iterator_handlers, zend_get_std_object_handlers(), sizeof(zend_object_handlers));
+    icu4c_stream_iterator_handlers.free_obj = icu4c_stream_iterator_free_object;
+    icu4c_stream_iterator_handlers.offset = XtOffsetOf(icu4c_stream_iterator_obj, std);
+    icu4c_stream_iterator_handlers.clone_obj = NULL;
+    
+    zend_class_implements(icu4c_stream_iterator_ce, 1, zend_ce_iterator);
+}
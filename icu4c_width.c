@@ -0,0 +1,723 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "php.h"
+#include "ext/standard/php_string.h"
+#include "php_icu4c.h"
+
+// Same values as str_pad()'s STR_PAD_* constants
+#ifndef STR_PAD_LEFT
+#define STR_PAD_LEFT  0
+#define STR_PAD_RIGHT 1
+#define STR_PAD_BOTH  2
+#endif
+
+#ifdef HAVE_ICU4C
+#if U_ICU_VERSION_MAJOR_NUM >= 63
+#include <unicode/ucpmap.h>
+#endif
+#include <unicode/uset.h>
+
+// Two-stage East Asian Width table: a block index per 256 code points
+// pointing into a pool of de-duplicated 256-entry blocks of UEastAsianWidth,
+// with the ICU4C_WIDTH_* flags or'ed in.
+#define ICU4C_WIDTH_BLOCK_SHIFT 8
+#define ICU4C_WIDTH_BLOCK_SIZE  (1 << ICU4C_WIDTH_BLOCK_SHIFT)
+#define ICU4C_WIDTH_BLOCK_COUNT ((UCHAR_MAX_VALUE + 1) >> ICU4C_WIDTH_BLOCK_SHIFT)
+
+// Built once at MINIT and read-only afterwards, so shared by all threads
+uint16_t *icu4c_width_index = NULL;
+uint8_t *icu4c_width_blocks = NULL;
+
+// Hash of a 256-entry block, used to find duplicates quickly
+static uint32_t icu4c_width_block_hash(const uint8_t *block)
+{
+    uint32_t hash = 2166136261u;
+    
+    for (int i = 0; i < ICU4C_WIDTH_BLOCK_SIZE; i++) {
+        hash = (hash ^ block[i]) * 16777619u;
+    }
+    
+    return hash;
+}
+
+// Set flag on every code point with the given property value
+static void icu4c_width_mark(uint8_t *values, UProperty property, int32_t value, uint8_t flag)
+{
+    UErrorCode status = U_ZERO_ERROR;
+    USet *set = uset_openEmpty();
+    
+    uset_applyIntPropertyValue(set, property, value, &status);
+    
+    for (int32_t i = 0; U_SUCCESS(status) && i < uset_getItemCount(set); i++) {
+        UChar32 start;
+        UChar32 end;
+        
+        // Length 0: the item is a code point range, not a string
+        if (uset_getItem(set, i, &start, &end, NULL, 0, &status) == 0 && U_SUCCESS(status)) {
+            for (UChar32 c = start; c <= end; c++) {
+                values[c] |= flag;
+            }
+        }
+    }
+    
+    uset_close(set);
+}
+
+// Build the East Asian Width table from ICU4C property data
+void icu4c_width_table_init(void)
+{
+    uint8_t *values = pemalloc(UCHAR_MAX_VALUE + 1, 1);
+    
+#if U_ICU_VERSION_MAJOR_NUM >= 63
+    UErrorCode status = U_ZERO_ERROR;
+    const UCPMap *map = u_getIntPropertyMap(UCHAR_EAST_ASIAN_WIDTH, &status);
+    
+    if (U_SUCCESS(status)) {
+        UChar32 start = 0;
+        uint32_t value;
+        UChar32 end;
+        
+        while ((end = ucpmap_getRange(map, start, UCPMAP_RANGE_NORMAL, 0, NULL, NULL, &value)) >= 0) {
+            memset(values + start, (int)value, end - start + 1);
+            start = end + 1;
+        }
+    } else
+#endif
+    {
+        for (UChar32 c = 0; c <= UCHAR_MAX_VALUE; c++) {
+            values[c] = (uint8_t)u_getIntPropertyValue(c, UCHAR_EAST_ASIAN_WIDTH);
+        }
+    }
+    
+    // Flags for the cluster width rules
+    icu4c_width_mark(values, UCHAR_GENERAL_CATEGORY_MASK, U_GC_MN_MASK | U_GC_ME_MASK, ICU4C_WIDTH_ZERO);
+    icu4c_width_mark(values, UCHAR_DEFAULT_IGNORABLE_CODE_POINT, 1, ICU4C_WIDTH_ZERO);
+    icu4c_width_mark(values, UCHAR_EMOJI_PRESENTATION, 1, ICU4C_WIDTH_EMOJI_PRESENTATION);
+    icu4c_width_mark(values, UCHAR_EMOJI, 1, ICU4C_WIDTH_EMOJI_BASE);
+#if U_ICU_VERSION_MAJOR_NUM >= 62
+    icu4c_width_mark(values, UCHAR_EXTENDED_PICTOGRAPHIC, 1, ICU4C_WIDTH_EMOJI_BASE);
+#endif
+    for (UChar32 c = 0x1F1E6; c <= 0x1F1FF; c++) {
+        values[c] |= ICU4C_WIDTH_REGIONAL;
+    }
+    
+    // De-duplicate blocks; most planes collapse into a handful of uniform blocks
+    uint32_t *hashes = pemalloc(ICU4C_WIDTH_BLOCK_COUNT * sizeof(uint32_t), 1);
+    uint32_t unique = 0;
+    
+    icu4c_width_index = pemalloc(ICU4C_WIDTH_BLOCK_COUNT * sizeof(uint16_t), 1);
+    icu4c_width_blocks = pemalloc(ICU4C_WIDTH_BLOCK_COUNT * ICU4C_WIDTH_BLOCK_SIZE, 1);
+    
+    for (uint32_t b = 0; b < ICU4C_WIDTH_BLOCK_COUNT; b++) {
+        const uint8_t *block = values + (b << ICU4C_WIDTH_BLOCK_SHIFT);
+        uint32_t hash = icu4c_width_block_hash(block);
+        uint32_t found = unique;
+        
+        for (uint32_t u = 0; u < unique; u++) {
+            if (hashes[u] == hash
+                && memcmp(icu4c_width_blocks + (u << ICU4C_WIDTH_BLOCK_SHIFT), block, ICU4C_WIDTH_BLOCK_SIZE) == 0) {
+                found = u;
+                break;
+            }
+        }
+        
+        if (found == unique) {
+            memcpy(icu4c_width_blocks + (unique << ICU4C_WIDTH_BLOCK_SHIFT), block, ICU4C_WIDTH_BLOCK_SIZE);
+            hashes[unique++] = hash;
+        }
+        icu4c_width_index[b] = (uint16_t)found;
+    }
+    
+    icu4c_width_blocks = perealloc(icu4c_width_blocks, unique << ICU4C_WIDTH_BLOCK_SHIFT, 1);
+    
+    pefree(hashes, 1);
+    pefree(values, 1);
+}
+
+// Free the East Asian Width table
+void icu4c_width_table_shutdown(void)
+{
+    if (icu4c_width_index) {
+        pefree(icu4c_width_index, 1);
+        icu4c_width_index = NULL;
+    }
+    
+    if (icu4c_width_blocks) {
+        pefree(icu4c_width_blocks, 1);
+        icu4c_width_blocks = NULL;
+    }
+}
+
+// Display width of a grapheme cluster, as terminals render it: the EAW
+// width of its first code point, except that
+// - a cluster starting with a combining mark or a default-ignorable
+//   code point (ZWJ, ZWSP, variation selector...) is 0
+// - an Emoji_Presentation base, an emoji followed by VS16 and a pair of
+//   regional indicators (a flag) are 2, whatever follows (ZWJ sequences,
+//   skin tone modifiers)
+static zend_always_inline int icu4c_cluster_width(const char *cluster, int32_t len, bool east_asian)
+{
+    UChar32 codepoint;
+    int32_t index = 0;
+    
+    U8_NEXT(cluster, index, len, codepoint);
+    
+    if (codepoint < 0) {
+        return 1;
+    }
+    
+    uint8_t props = icu4c_width_props(codepoint);
+    
+    if (props & ICU4C_WIDTH_ZERO) {
+        return 0;
+    }
+    if (props & ICU4C_WIDTH_REGIONAL) {
+        return index < len ? 2 : 1;
+    }
+    if (props & ICU4C_WIDTH_EMOJI_PRESENTATION) {
+        return 2;
+    }
+    
+    int width = icu4c_eaw_to_width((UEastAsianWidth)(props & ICU4C_WIDTH_EAW_MASK), east_asian);
+    
+    if (width < 2 && (props & ICU4C_WIDTH_EMOJI_BASE)) {
+        // Text-default emoji (e.g. U+2764) switched to emoji presentation
+        while (index < len) {
+            U8_NEXT(cluster, index, len, codepoint);
+            if (codepoint == 0xFE0F) {
+                return 2;
+            }
+        }
+    }
+    
+    return width;
+}
+
+// Display width of the first grapheme cluster of text, or -1 if text
+// is empty or does not start with a valid UTF-8 sequence
+int icu4c_first_cluster_width(const char *text, size_t text_len, bool east_asian)
+{
+    UChar32 codepoint;
+    int32_t index = 0;
+    
+    if (text_len == 0) {
+        return -1;
+    }
+    
+    U8_NEXT(text, index, (int32_t)MIN(text_len, 4), codepoint);
+    if (codepoint < 0) {
+        return -1;
+    }
+    
+    icu4c_break_cursor cursor;
+    icu4c_break_cursor_open(&cursor, text, text_len, UBRK_CHARACTER, NULL);
+    int32_t end = icu4c_break_cursor_next(&cursor);
+    icu4c_break_cursor_close(&cursor);
+    
+    if (end == UBRK_DONE) {
+        return -1;
+    }
+    
+    return icu4c_cluster_width(text, end, east_asian);
+}
+
+// Display width of a whole UTF-8 string, summed per grapheme cluster
+size_t icu4c_string_width(const char *text, size_t text_len, bool east_asian)
+{
+    icu4c_break_cursor cursor;
+    size_t width = 0;
+    int32_t start = 0;
+    int32_t end;
+    ICU4C_TIMER_START(timer);
+    
+    icu4c_break_cursor_open(&cursor, text, text_len, UBRK_CHARACTER, NULL);
+    
+    while ((end = icu4c_break_cursor_next(&cursor)) != UBRK_DONE) {
+        width += icu4c_cluster_width(text + start, end - start, east_asian);
+        start = end;
+    }
+    
+    icu4c_break_cursor_close(&cursor);
+    ICU4C_TIMER_STOP(timer, width_ns);
+    
+    return width;
+}
+
+// Fill columns with repetitions of pad, never splitting a pad cluster;
+// a cluster that would overflow is replaced by spaces. With out == NULL
+// only the byte length is computed.
+static size_t icu4c_pad_fill(char *out, const char *pad, size_t pad_len, size_t columns, bool east_asian)
+{
+    icu4c_break_cursor cursor;
+    size_t written = 0;
+    int32_t start = 0;
+    int32_t end;
+    
+    icu4c_break_cursor_open(&cursor, pad, pad_len, UBRK_CHARACTER, NULL);
+    
+    while (columns > 0) {
+        end = icu4c_break_cursor_next(&cursor);
+        
+        if (end == UBRK_DONE) {
+            // Wrap around to the start of the pad string
+            icu4c_break_cursor_close(&cursor);
+            icu4c_break_cursor_open(&cursor, pad, pad_len, UBRK_CHARACTER, NULL);
+            start = 0;
+            continue;
+        }
+        
+        size_t width = icu4c_cluster_width(pad + start, end - start, east_asian);
+        
+        if (width > columns) {
+            if (out) {
+                memset(out + written, ' ', columns);
+            }
+            written += columns;
+            break;
+        }
+        
+        if (out) {
+            memcpy(out + written, pad + start, end - start);
+        }
+        written += end - start;
+        columns -= width;
+        start = end;
+    }
+    
+    icu4c_break_cursor_close(&cursor);
+    
+    return written;
+}
+#endif
+
+// Display width of a UTF-8 string. Without ICU4C: 1 column per
+// single-byte and 2 per multi-byte character.
+static size_t icu4c_text_width(const char *text, size_t text_len, bool east_asian)
+{
+#ifdef HAVE_ICU4C
+    return icu4c_string_width(text, text_len, east_asian);
+#else
+    const unsigned char *str = (const unsigned char *)text;
+    size_t width = 0;
+    
+    (void)east_asian;
+    for (size_t pos = 0; pos < text_len; pos++) {
+        if (str[pos] < 0x80) {
+            width += 1;
+        } else if ((str[pos] & 0xC0) != 0x80) {
+            width += 2;
+        }
+    }
+    
+    return width;
+#endif
+}
+
+// Whether ambiguous-width characters are wide for an optional locale
+static bool icu4c_locale_is_east_asian(const zend_string *locale)
+{
+#ifdef HAVE_ICU4C
+    return locale && icu4c_is_east_asian_locale(ZSTR_VAL(locale));
+#else
+    (void)locale;
+    return false;
+#endif
+}
+
+// Display width of an array element; non-string scalars are converted
+// as by (string). Returns false (with an exception) for other values.
+static bool icu4c_value_width(zval *value, bool east_asian, size_t *width)
+{
+    zend_string *tmp;
+    zend_string *str = zval_try_get_tmp_string(value, &tmp);
+    
+    if (!str) {
+        return false;
+    }
+    
+    *width = icu4c_text_width(ZSTR_VAL(str), ZSTR_LEN(str), east_asian);
+    zend_tmp_string_release(tmp);
+    
+    return true;
+}
+
+// icu4c_str_width function implementation
+PHP_FUNCTION(icu4c_str_width)
+{
+    zend_string *text;
+    zend_string *locale = NULL;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_STR(text)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR_OR_NULL(locale)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    // Resolve the locale once for the whole string
+    bool east_asian = icu4c_locale_is_east_asian(locale);
+    
+    RETURN_LONG((zend_long)icu4c_text_width(ZSTR_VAL(text), ZSTR_LEN(text), east_asian));
+}
+
+// icu4c_eaw_widths function implementation: widths of many strings (or
+// the widest cell of each column of a table) in one call
+PHP_FUNCTION(icu4c_eaw_widths)
+{
+    HashTable *strings;
+    zend_string *locale = NULL;
+    bool columns = false;
+    zend_ulong index;
+    zend_string *key;
+    zval *value;
+    HashTable *result;
+    
+    ZEND_PARSE_PARAMETERS_START(1, 3)
+        Z_PARAM_ARRAY_HT(strings)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR_OR_NULL(locale)
+        Z_PARAM_BOOL(columns)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    // Resolve the locale once for all elements
+    bool east_asian = icu4c_locale_is_east_asian(locale);
+    
+    if (!columns) {
+        // Width of each string, under the same key
+        result = zend_new_array(zend_hash_num_elements(strings));
+        
+        ZEND_HASH_FOREACH_KEY_VAL(strings, index, key, value) {
+            size_t width;
+            zval entry;
+            
+            ZVAL_DEREF(value);
+            if (!icu4c_value_width(value, east_asian, &width)) {
+                zend_array_destroy(result);
+                RETURN_THROWS();
+            }
+            
+            ZVAL_LONG(&entry, (zend_long)width);
+            if (key) {
+                zend_hash_add_new(result, key, &entry);
+            } else {
+                zend_hash_index_add_new(result, index, &entry);
+            }
+        } ZEND_HASH_FOREACH_END();
+        
+        RETURN_ARR(result);
+    }
+    
+    // Rows of cells: maximum width seen under each column key
+    result = zend_new_array(0);
+    
+    ZEND_HASH_FOREACH_VAL(strings, value) {
+        zval *cell;
+        
+        ZVAL_DEREF(value);
+        if (Z_TYPE_P(value) != IS_ARRAY) {
+            zend_array_destroy(result);
+            zend_argument_type_error(1, "must contain only arrays when $columns is true, %s given",
+                zend_zval_type_name(value));
+            RETURN_THROWS();
+        }
+        
+        ZEND_HASH_FOREACH_KEY_VAL(Z_ARRVAL_P(value), index, key, cell) {
+            size_t width;
+            
+            ZVAL_DEREF(cell);
+            if (!icu4c_value_width(cell, east_asian, &width)) {
+                zend_array_destroy(result);
+                RETURN_THROWS();
+            }
+            
+            zval *max = key ? zend_hash_find(result, key) : zend_hash_index_find(result, index);
+            
+            if (max) {
+                if ((zend_long)width > Z_LVAL_P(max)) {
+                    ZVAL_LONG(max, (zend_long)width);
+                }
+            } else {
+                zval entry;
+                
+                ZVAL_LONG(&entry, (zend_long)width);
+                if (key) {
+                    zend_hash_add_new(result, key, &entry);
+                } else {
+                    zend_hash_index_add_new(result, index, &entry);
+                }
+            }
+        } ZEND_HASH_FOREACH_END();
+    } ZEND_HASH_FOREACH_END();
+    
+    RETURN_ARR(result);
+}
+
+#ifdef HAVE_ICU4C
+// icu4c_str_truncate function implementation
+PHP_FUNCTION(icu4c_str_truncate)
+{
+    zend_string *text;
+    zend_long max_width;
+    zend_string *ellipsis = NULL;
+    zend_string *locale = NULL;
+    
+    ZEND_PARSE_PARAMETERS_START(2, 4)
+        Z_PARAM_STR(text)
+        Z_PARAM_LONG(max_width)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR(ellipsis)
+        Z_PARAM_STR_OR_NULL(locale)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    if (max_width < 0) {
+        zend_argument_value_error(2, "must be greater than or equal to 0");
+        RETURN_THROWS();
+    }
+    
+    bool east_asian = locale && icu4c_is_east_asian_locale(ZSTR_VAL(locale));
+    const char *str = ZSTR_VAL(text);
+    size_t ellipsis_width = ellipsis ? icu4c_string_width(ZSTR_VAL(ellipsis), ZSTR_LEN(ellipsis), east_asian) : 0;
+    
+    // An ellipsis wider than the budget is dropped
+    if (ellipsis_width > (size_t)max_width) {
+        ellipsis = NULL;
+        ellipsis_width = 0;
+    }
+    
+    // One pass: remember the last cut that leaves room for the ellipsis,
+    // and stop as soon as the text is known not to fit
+    size_t budget = (size_t)max_width - ellipsis_width;
+    size_t width = 0;
+    int32_t cut = 0;
+    int32_t start = 0;
+    int32_t end;
+    bool fits = true;
+    icu4c_break_cursor cursor;
+    ICU4C_TIMER_START(timer);
+    
+    icu4c_break_cursor_open(&cursor, str, ZSTR_LEN(text), UBRK_CHARACTER, NULL);
+    
+    while ((end = icu4c_break_cursor_next(&cursor)) != UBRK_DONE) {
+        width += icu4c_cluster_width(str + start, end - start, east_asian);
+        
+        if (width > (size_t)max_width) {
+            fits = false;
+            break;
+        }
+        if (width <= budget) {
+            cut = end;
+        }
+        start = end;
+    }
+    
+    icu4c_break_cursor_close(&cursor);
+    ICU4C_TIMER_STOP(timer, width_ns);
+    
+    if (fits) {
+        RETURN_STR_COPY(text);
+    }
+    
+    size_t ellipsis_len = ellipsis ? ZSTR_LEN(ellipsis) : 0;
+    zend_string *result = zend_string_alloc(cut + ellipsis_len, 0);
+    
+    memcpy(ZSTR_VAL(result), str, cut);
+    if (ellipsis_len) {
+        memcpy(ZSTR_VAL(result) + cut, ZSTR_VAL(ellipsis), ellipsis_len);
+    }
+    ZSTR_VAL(result)[cut + ellipsis_len] = '\0';
+    
+    RETURN_NEW_STR(result);
+}
+
+// icu4c_str_pad function implementation
+PHP_FUNCTION(icu4c_str_pad)
+{
+    zend_string *text;
+    zend_long target_width;
+    zend_string *pad = NULL;
+    zend_long pad_type = STR_PAD_RIGHT;
+    zend_string *locale = NULL;
+    
+    ZEND_PARSE_PARAMETERS_START(2, 5)
+        Z_PARAM_STR(text)
+        Z_PARAM_LONG(target_width)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR(pad)
+        Z_PARAM_LONG(pad_type)
+        Z_PARAM_STR_OR_NULL(locale)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    if (pad_type != STR_PAD_LEFT && pad_type != STR_PAD_RIGHT && pad_type != STR_PAD_BOTH) {
+        zend_argument_value_error(4, "must be STR_PAD_LEFT, STR_PAD_RIGHT, or STR_PAD_BOTH");
+        RETURN_THROWS();
+    }
+    
+    bool east_asian = locale && icu4c_is_east_asian_locale(ZSTR_VAL(locale));
+    const char *pad_str = pad ? ZSTR_VAL(pad) : " ";
+    size_t pad_len = pad ? ZSTR_LEN(pad) : 1;
+    
+    if (pad_len == 0 || icu4c_string_width(pad_str, pad_len, east_asian) == 0) {
+        zend_argument_value_error(3, "must have a non-zero display width");
+        RETURN_THROWS();
+    }
+    
+    size_t width = icu4c_string_width(ZSTR_VAL(text), ZSTR_LEN(text), east_asian);
+    
+    if (target_width <= 0 || width >= (size_t)target_width) {
+        RETURN_STR_COPY(text);
+    }
+    
+    size_t columns = (size_t)target_width - width;
+    size_t left_columns = 0;
+    
+    if (pad_type == STR_PAD_LEFT) {
+        left_columns = columns;
+    } else if (pad_type == STR_PAD_BOTH) {
+        left_columns = columns / 2;
+    }
+    size_t right_columns = columns - left_columns;
+    
+    // Measure, then write the result in a single allocation
+    size_t left_len = icu4c_pad_fill(NULL, pad_str, pad_len, left_columns, east_asian);
+    size_t right_len = icu4c_pad_fill(NULL, pad_str, pad_len, right_columns, east_asian);
+    zend_string *result = zend_string_alloc(left_len + ZSTR_LEN(text) + right_len, 0);
+    char *out = ZSTR_VAL(result);
+    
+    icu4c_pad_fill(out, pad_str, pad_len, left_columns, east_asian);
+    memcpy(out + left_len, ZSTR_VAL(text), ZSTR_LEN(text));
+    icu4c_pad_fill(out + left_len + ZSTR_LEN(text), pad_str, pad_len, right_columns, east_asian);
+    out[ZSTR_LEN(result)] = '\0';
+    
+    RETURN_NEW_STR(result);
+}
+
+// Append the line text[start, end) to lines, as a string or as a
+// [byteStart, byteLength] pair
+static void icu4c_wrap_emit(zval *lines, const char *text, int32_t start, int32_t end, bool offsets)
+{
+    if (offsets) {
+        zval pair;
+        array_init_size(&pair, 2);
+        add_next_index_long(&pair, start);
+        add_next_index_long(&pair, end - start);
+        add_next_index_zval(lines, &pair);
+    } else {
+        add_next_index_stringl(lines, text + start, end - start);
+    }
+}
+
+// icu4c_wrap function implementation
+PHP_FUNCTION(icu4c_wrap)
+{
+    zend_string *text;
+    zend_long columns;
+    zend_string *locale = NULL;
+    bool offsets = false;
+    
+    ZEND_PARSE_PARAMETERS_START(2, 4)
+        Z_PARAM_STR(text)
+        Z_PARAM_LONG(columns)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_STR_OR_NULL(locale)
+        Z_PARAM_BOOL(offsets)
+    ZEND_PARSE_PARAMETERS_END();
+    
+    if (columns < 1) {
+        zend_argument_value_error(2, "must be greater than 0");
+        RETURN_THROWS();
+    }
+    
+    if (ZSTR_LEN(text) > INT32_MAX) {
+        zend_argument_value_error(1, "must not be longer than 2 GB");
+        RETURN_THROWS();
+    }
+    
+    array_init(return_value);
+    
+    bool east_asian = locale && icu4c_is_east_asian_locale(ZSTR_VAL(locale));
+    const char *str = ZSTR_VAL(text);
+    int32_t len = (int32_t)ZSTR_LEN(text);
+    
+    // One pass over the grapheme clusters, checked against the line break
+    // opportunities (UAX #14, including kinsoku for CJK punctuation). A
+    // segment is the text between two opportunities; trailing spaces and
+    // line terminators never count against the width of a line.
+    icu4c_break_cursor clusters;
+    icu4c_break_cursor breaks;
+    size_t line_width = 0;       // Width of the segments in the line
+    int32_t line_start = 0;
+    int32_t line_end = 0;        // End of the last non-space cluster in the line
+    size_t segment_width = 0;
+    int32_t segment_start = 0;
+    int32_t segment_end = 0;     // End of the last non-space cluster in the segment
+    int32_t start = 0;
+    int32_t end;
+    ICU4C_TIMER_START(timer);
+    
+    icu4c_break_cursor_open(&clusters, str, len, UBRK_CHARACTER, NULL);
+    icu4c_break_cursor_open(&breaks, str, len, UBRK_LINE, locale ? ZSTR_VAL(locale) : NULL);
+    
+    int32_t opportunity = icu4c_break_cursor_next(&breaks);
+    
+    while ((end = icu4c_break_cursor_next(&clusters)) != UBRK_DONE) {
+        UChar32 codepoint;
+        int32_t index = start;
+        
+        U8_NEXT(str, index, end, codepoint);
+        
+        int32_t line_break = codepoint < 0 ? U_LB_UNKNOWN : u_getIntPropertyValue(codepoint, UCHAR_LINE_BREAK);
+        bool hard = line_break == U_LB_MANDATORY_BREAK || line_break == U_LB_CARRIAGE_RETURN
+            || line_break == U_LB_LINE_FEED || line_break == U_LB_NEXT_LINE;
+        size_t width = icu4c_cluster_width(str + start, end - start, east_asian);
+        
+        if (!hard && line_break != U_LB_SPACE) {
+            if (line_width + segment_width + width > (size_t)columns) {
+                // Move the segment to a new line...
+                if (line_end > line_start) {
+                    icu4c_wrap_emit(return_value, str, line_start, line_end, offsets);
+                    line_start = segment_start;
+                    line_end = segment_start;
+                    line_width = 0;
+                }
+                // ...and split it between clusters if it is wider than a line
+                if (line_width + segment_width + width > (size_t)columns && segment_end > line_start) {
+                    icu4c_wrap_emit(return_value, str, line_start, segment_end, offsets);
+                    line_start = segment_start = segment_end = line_end = start;
+                    line_width = segment_width = 0;
+                }
+            }
+            segment_end = end;
+        }
+        segment_width += width;
+        
+        if (end >= opportunity || end == len) {
+            line_width += segment_width;
+            if (segment_end > segment_start) {
+                line_end = segment_end;
+            }
+            if (hard) {
+                icu4c_wrap_emit(return_value, str, line_start, line_end, offsets);
+                line_start = line_end = end;
+                line_width = 0;
+            }
+            segment_start = segment_end = end;
+            segment_width = 0;
+            
+            while (opportunity != UBRK_DONE && opportunity <= end) {
+                opportunity = icu4c_break_cursor_next(&breaks);
+            }
+        }
+        start = end;
+    }
+    
+    // Spaces after the last line (or making up the whole text) are not a line
+    if (line_end > line_start) {
+        icu4c_wrap_emit(return_value, str, line_start, line_end, offsets);
+    }
+    
+    icu4c_break_cursor_close(&breaks);
+    icu4c_break_cursor_close(&clusters);
+    ICU4C_TIMER_STOP(timer, width_ns);
+}
+#endif
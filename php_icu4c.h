@@ -10,26 +10,244 @@
 #include <unicode/uloc.h>
 #include <unicode/ustring.h>
 #include <unicode/uchar.h>
+#else
+// Stand-ins for the ICU4C break constants used by the boundary cursor,
+// which segments by code point when built without ICU4C
+typedef int UBreakIteratorType;
+#define UBRK_CHARACTER        0
+#define UBRK_WORD             1
+#define UBRK_LINE             2
+#define UBRK_SENTENCE         3
+#define UBRK_DONE             ((int32_t)-1)
+#define UBRK_WORD_NONE        0
+#define UBRK_WORD_NONE_LIMIT  100
+#define UBRK_WORD_LETTER      200
 #endif
 
 #define PHP_ICU4C_VERSION "1.0.0"
 #define PHP_ICU4C_EXTNAME "icu4c"
 
+// icu4c_iter() / ICU4CIterator flags
+#define ICU4C_ITER_OFFSETS        (1 << 0)  // Yield [byteStart, byteLength] instead of strings
+#define ICU4C_ITER_SKIP_NONWORDS  (1 << 1)  // Word mode: skip whitespace/punctuation segments
+#define ICU4C_ITER_REVERSE        (1 << 2)  // Iterate from the last segment to the first
+#define ICU4C_ITER_FLAGS_MASK     (ICU4C_ITER_OFFSETS | ICU4C_ITER_SKIP_NONWORDS | ICU4C_ITER_REVERSE)
+
+// icu4c_iter_stream() / ICU4CStreamIterator chunk sizes
+#define ICU4C_STREAM_CHUNK_SIZE      65536              // Default bytes read per refill
+#define ICU4C_STREAM_MAX_CHUNK_SIZE  (64 * 1024 * 1024) // Keeps buffer offsets within int32_t
+
+// icu4c_iter() / ICU4CIterator segmentation modes (same values as UBreakIteratorType)
+#define ICU4C_BREAK_GRAPHEME  0
+#define ICU4C_BREAK_WORD      1
+#define ICU4C_BREAK_LINE      2
+#define ICU4C_BREAK_SENTENCE  3
+
 extern zend_module_entry icu4c_module_entry;
 #define phpext_icu4c_ptr &icu4c_module_entry
 
+#ifdef HAVE_ICU4C
+// Cached prototype break iterator keyed by (break type, locale)
+typedef struct _icu4c_break_iter_entry {
+    UBreakIteratorType type;                // Break type (UBRK_CHARACTER, ...)
+    char locale[ULOC_FULLNAME_CAPACITY];    // Locale the prototype was opened for
+    UBreakIterator *proto;                  // Prototype iterator (NULL if slot unused)
+    uint64_t last_used;                     // LRU clock value of the last acquire
+    bool in_use;                            // Prototype currently lent out
+} icu4c_break_iter_entry;
+#endif
+
+// Cursor over break boundaries of UTF-8 text, forward from the start or
+// (after icu4c_break_cursor_last()) backward from the end.
+// For grapheme clusters, runs of ASCII/Latin-1 code points are segmented
+// directly; ICU4C is only opened for the spans that may form
+// multi-codepoint clusters. Without ICU4C every code point is a segment.
+typedef struct _icu4c_break_cursor {
+    const char *text;            // UTF-8 text (not owned)
+    int32_t text_len;            // Text length in bytes
+    UBreakIteratorType type;     // Break type
+    const char *locale;          // Locale for the break rules (not owned, NULL for default)
+    int32_t pos;                 // Last boundary returned
+    int32_t rule_status;         // ubrk_getRuleStatus() of the last segment stepped over
+    int32_t ascii_end;           // End of the scanned ASCII run containing pos
+#ifdef HAVE_ICU4C
+    UBreakIterator *break_iter;  // Opened on first complex span, NULL before
+    UText *utext;               // UText bound to break_iter
+    bool synced;                // break_iter is positioned at pos
+#endif
+    bool failed;                // ICU4C could not be opened (or text too long)
+} icu4c_break_cursor;
+
+// Bytes scanned for ASCII at a time, so stepping costs the same on long text
+#define ICU4C_ASCII_SCAN_WINDOW       4096
+
+// Segmentation cache (icu4c_cache.c): finished boundary indexes of
+// ICU4CIterator texts, keyed by text, mode, word filter and locale, in a
+// set-associative table with LRU replacement within each set
+#define ICU4C_SEGMENT_CACHE_WAYS      2      // Entries per set
+#define ICU4C_SEGMENT_CACHE_MAX_TEXT  65536  // Longest text cached, in bytes
+#define ICU4C_SHARED_INDEX_SLOTS      64     // Entries in the interned text map
+
+typedef struct _icu4c_boundary_index icu4c_boundary_index;
+
+typedef struct _icu4c_segment_cache_entry {
+    icu4c_boundary_index *index;  // Reference held by the cache (NULL for an empty slot)
+    zend_ulong hash;              // Hash of the whole key
+    uint64_t last_used;           // Cache clock value of the last hit
+} icu4c_segment_cache_entry;
+
+typedef struct _icu4c_segment_cache {
+    icu4c_segment_cache_entry *entries;  // sets * ICU4C_SEGMENT_CACHE_WAYS slots, allocated on first store
+    size_t sets;                         // Number of sets (a power of two)
+    uint64_t clock;                      // LRU clock
+    bool persistent;                     // Entries outlive the request (pemalloc'd copies)
+} icu4c_segment_cache;
+
+// Instrumentation counters reported by icu4c_stats() (per thread)
+typedef struct _icu4c_stats {
+    zend_ulong iterators_created;     // ICU4CIterator and ICU4CStreamIterator objects set up
+    zend_ulong bytes_segmented;       // Bytes covered by boundaries returned from cursors
+    zend_ulong segments;              // Boundaries returned from cursors
+    zend_ulong fast_path_segments;    // ... of which found without consulting ICU4C
+    zend_ulong break_iter_hits;       // Requests served from the pool
+    zend_ulong break_iter_misses;     // Requests that needed ubrk_open()
+    zend_ulong break_iter_clones;     // Requests for a busy prototype, served by cloning it
+    zend_ulong break_iter_evictions;  // Prototypes closed to make room
+    zend_ulong boundary_reallocs;     // Growths of boundary arrays
+    zend_ulong segment_cache_hits;    // Iterators served from the per-request segmentation cache
+    zend_ulong segment_cache_persistent_hits;  // ... from the persistent segmentation cache
+    zend_ulong segment_cache_misses;  // Cacheable iterators segmented from scratch
+    zend_ulong segment_cache_evictions;  // Segmentation cache entries replaced
+    zend_ulong shared_index_hits;     // Iterators sharing the index of an earlier one over the same interned text
+    zend_ulong parallel_segmentations;  // Texts segmented on worker threads (icu4c.parallel_threads)
+    zend_ulong fallbacks;             // Cursors segmenting without ICU4C (unavailable or failed)
+    uint64_t segmentation_ns;         // Time spent finding boundaries (icu4c.stats_timers)
+    uint64_t width_ns;                // Time spent measuring widths (icu4c.stats_timers)
+} icu4c_stats;
+
+// Module globals (per thread under ZTS)
+ZEND_BEGIN_MODULE_GLOBALS(icu4c)
+#ifdef HAVE_ICU4C
+    icu4c_break_iter_entry *break_iter_pool;  // LRU of prototypes, allocated on first use
+#endif
+    zend_long break_iter_cache_size;  // icu4c.break_iterator_cache_size
+    uint64_t break_iter_clock;        // LRU clock
+    zend_long segment_cache_size;     // icu4c.segment_cache_size
+    zend_long persistent_segment_cache_size;  // icu4c.persistent_segment_cache_size
+    icu4c_segment_cache segment_cache;             // Per-request tier
+    icu4c_segment_cache persistent_segment_cache;  // Cross-request tier
+    icu4c_segment_cache shared_indexes;  // Indexes of interned texts, finished or not (per request)
+    zend_long parallel_threads;       // icu4c.parallel_threads
+    zend_long parallel_min_size;      // icu4c.parallel_min_size
+    bool stats_timers;                // icu4c.stats_timers
+    icu4c_stats stats;                // Counters since thread start or icu4c_stats(true)
+ZEND_END_MODULE_GLOBALS(icu4c)
+
+ZEND_EXTERN_MODULE_GLOBALS(icu4c)
+#define ICU4C_G(v) ZEND_MODULE_GLOBALS_ACCESSOR(icu4c, v)
+
+#if defined(ZTS) && defined(COMPILE_DL_ICU4C)
+ZEND_TSRMLS_CACHE_EXTERN()
+#endif
+
+// Monotonic clock for the optional timers
+#if PHP_VERSION_ID >= 80300
+# include "zend_hrtime.h"
+# define icu4c_hrtime() zend_hrtime()
+#else
+# include "ext/standard/hrtime.h"
+# define icu4c_hrtime() php_hrtime_current()
+#endif
+
+// Cumulative timers: no clock reads unless icu4c.stats_timers is on
+#define ICU4C_TIMER_START(start) \
+    uint64_t start = ICU4C_G(stats_timers) ? icu4c_hrtime() : 0
+#define ICU4C_TIMER_STOP(start, counter) do { \
+        if (start) { \
+            ICU4C_G(stats).counter += icu4c_hrtime() - (start); \
+        } \
+    } while (0)
+
+// Count one segmentation run by the code point fallback (builds without
+// ICU4C); ICU4C builds count the cursors that could not open ICU4C instead
+#ifdef HAVE_ICU4C
+# define ICU4C_COUNT_FALLBACK() do { } while (0)
+#else
+# define ICU4C_COUNT_FALLBACK() (ICU4C_G(stats).fallbacks++)
+#endif
+
 // ICU4CIterator class entry
 extern zend_class_entry *icu4c_iterator_ce;
 
+// Compact boundary storage: clusters are recorded as byte lengths, one byte
+// each, with a checkpoint every ICU4C_CHECKPOINT_INTERVAL clusters so that
+// the offset of any cluster is found by summing at most that many lengths
+#define ICU4C_LENGTH_ESCAPE           0xFF  // Length stored in length_overflow
+#define ICU4C_CHECKPOINT_SHIFT        6
+#define ICU4C_CHECKPOINT_INTERVAL     (1 << ICU4C_CHECKPOINT_SHIFT)
+
+typedef struct _icu4c_boundary_checkpoint {
+    uint32_t offset;    // Byte offset of the cluster
+    uint32_t overflow;  // length_overflow entries used before it
+} icu4c_boundary_checkpoint;
+
+// Segment found by reverse iteration
+typedef struct _icu4c_boundary_span {
+    int32_t start;      // Byte offset of the segment
+    int32_t len;        // Byte length of the segment
+} icu4c_boundary_span;
+
+// Boundaries of one text under one segmentation (mode, word filter,
+// locale). Refcounted: clones, iterators over the same interned string and
+// the segmentation cache share an index, each iterator keeping its own
+// position; whichever needs a later segment first extends it for all.
+// Reverse iterators extend a separate tail, segmented backward from the
+// end, which is dropped once the forward boundaries are complete.
+struct _icu4c_boundary_index {
+    uint32_t refcount;          // Iterators and caches holding the index
+    bool persistent;            // Allocated with pemalloc(..., 1) (persistent segmentation cache)
+    bool words_only;            // Keeps segment_index (ICU4C_ITER_SKIP_NONWORDS)
+    bool complete;              // All boundaries have been computed
+    bool tail_complete;         // tail reaches the start of the text
+    zend_long mode;             // ICU4C_BREAK_* segmentation mode
+    zend_string *text;          // Segmented text
+    zend_string *locale;        // Locale for the break rules (NULL for default)
+    icu4c_break_cursor cursor;  // Boundary cursor (alive until segmentation completes)
+    size_t total_clusters;      // Grapheme clusters found so far (total once complete)
+    int32_t end_offset;         // Byte offset where the last known cluster ends
+    uint8_t *cluster_lengths;   // Byte length of each cluster (ICU4C_LENGTH_ESCAPE: in length_overflow)
+    size_t lengths_capacity;    // Allocated entries in cluster_lengths
+    uint32_t *length_overflow;  // Lengths of clusters too long for a byte, in order
+    size_t overflow_count;      // Entries used in length_overflow
+    size_t overflow_capacity;   // Allocated entries in length_overflow
+    icu4c_boundary_checkpoint *checkpoints; // Start of every ICU4C_CHECKPOINT_INTERVAL-th cluster
+    size_t checkpoint_capacity; // Allocated entries in checkpoints
+    uint32_t *segment_index;    // Boundary index of each kept segment (words_only only)
+    size_t segment_count;       // Kept segments found so far
+    size_t segment_capacity;    // Allocated entries in segment_index
+    icu4c_break_cursor tail_cursor; // Backward cursor for reverse iteration (alive until the tail is complete)
+    icu4c_boundary_span *tail;  // Visible segments found from the end, last first (NULL until needed)
+    size_t tail_count;          // Entries used in tail
+    size_t tail_capacity;       // Allocated entries in tail
+};
+
+static zend_always_inline icu4c_boundary_index *icu4c_boundary_index_addref(icu4c_boundary_index *index)
+{
+    index->refcount++;
+    return index;
+}
+
 // ICU4CIterator object structure
 typedef struct _icu4c_iterator_obj {
-    zend_string *text;           // Original text string
-    UBreakIterator *break_iter;  // ICU4C BreakIterator
-    UText *utext;               // ICU4C UText
-    size_t current_pos;         // Current position (cluster index)
-    size_t total_clusters;      // Total number of grapheme clusters
-    int32_t *cluster_boundaries; // Array of cluster boundary positions
-    zend_object std;            // Standard object
+    zend_string *text;            // Original text string
+    icu4c_boundary_index *index;  // Boundaries, possibly shared (NULL until constructed)
+    zend_long flags;              // ICU4C_ITER_* flags
+    size_t current_pos;           // Current position (cluster index)
+    bool from_last;               // current_pos counts back from the last segment (after last())
+    size_t seek_index;            // Last cluster located by icu4c_iterator_locate()
+    int32_t seek_offset;          // Its start offset
+    size_t seek_overflow;         // length_overflow entries used before it
+    zend_object std;              // Standard object
 } icu4c_iterator_obj;
 
 // Object accessor macro
@@ -37,6 +255,40 @@ static inline icu4c_iterator_obj *icu4c_iterator_from_obj(zend_object *obj) {
     return (icu4c_iterator_obj*)((char*)(obj) - XtOffsetOf(icu4c_iterator_obj, std));
 }
 
+// ICU4CStreamIterator class entry
+extern zend_class_entry *icu4c_stream_iterator_ce;
+
+// ICU4CStreamIterator object structure: a forward-only window over a stream.
+// The buffer holds the unfinished cluster carried over from the previous
+// chunk followed by the newest chunk, so memory is bounded by chunk size.
+// For icu4c_iter_file() the buffer is instead a window into a read-only
+// mapping of the file, and sliding it never copies.
+typedef struct _icu4c_stream_iterator_obj {
+    zval stream;                 // Stream resource being segmented
+    php_stream *file;           // Stream opened by icu4c_iter_file() (owned)
+    const char *mapping;        // Read-only mapping of file, NULL when reading chunks
+    size_t mapping_len;         // Bytes in mapping
+    zend_long flags;            // ICU4C_ITER_* flags
+    size_t chunk_size;          // Bytes requested per read (window growth when mapped)
+    char *buffer;               // Carried-over text followed by the current chunk
+    size_t buffer_len;          // Bytes in buffer
+    size_t buffer_capacity;     // Allocated bytes in buffer
+    uint64_t buffer_offset;     // Stream offset of buffer[0]
+    size_t scan_len;            // Prefix of buffer without a truncated UTF-8 sequence
+    icu4c_break_cursor cursor;  // Boundary cursor over buffer[0, scan_len)
+    int32_t cluster_start;      // Current cluster start in buffer
+    int32_t cluster_end;        // Current cluster end in buffer (== start when done)
+    zend_long key;              // Index of the current cluster
+    bool started;               // First cluster has been read
+    bool eof;                   // Stream is exhausted; buffered text is final
+    zend_object std;            // Standard object
+} icu4c_stream_iterator_obj;
+
+// Object accessor macro
+static inline icu4c_stream_iterator_obj *icu4c_stream_iterator_from_obj(zend_object *obj) {
+    return (icu4c_stream_iterator_obj*)((char*)(obj) - XtOffsetOf(icu4c_stream_iterator_obj, std));
+}
+
 // Internal iterator structure for IteratorAggregate
 typedef struct _icu4c_internal_iterator {
     zend_object_iterator intern;
@@ -47,10 +299,25 @@ typedef struct _icu4c_internal_iterator {
 // Function declarations
 PHP_FUNCTION(icu4c_iter);
 PHP_FUNCTION(icu4c_eaw_width);
+PHP_FUNCTION(icu4c_graphemes);
+PHP_FUNCTION(icu4c_grapheme_len);
+PHP_FUNCTION(icu4c_str_width);
+PHP_FUNCTION(icu4c_eaw_widths);
+PHP_FUNCTION(icu4c_iter_stream);
+PHP_FUNCTION(icu4c_iter_file);
+PHP_FUNCTION(icu4c_stats);
+#ifdef HAVE_ICU4C
+PHP_FUNCTION(icu4c_str_truncate);
+PHP_FUNCTION(icu4c_str_pad);
+PHP_FUNCTION(icu4c_wrap);
+#endif
 
 // ArgInfo declarations
 ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iter, 0, 0, 1)
     ZEND_ARG_TYPE_INFO(0, text, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, flags, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, mode, IS_LONG, 0, "ICU4C_BREAK_GRAPHEME")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, locale, IS_STRING, 1, "null")
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_eaw_width, 0, 0, 1)
@@ -58,8 +325,74 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_eaw_width, 0, 0, 1)
     ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, locale, IS_STRING, 1, "null")
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_graphemes, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, text, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_grapheme_len, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, text, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, limit, IS_LONG, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_str_width, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, text, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, locale, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_eaw_widths, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, strings, IS_ARRAY, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, locale, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, columns, _IS_BOOL, 0, "false")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_str_truncate, 0, 0, 2)
+    ZEND_ARG_TYPE_INFO(0, text, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, width, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, ellipsis, IS_STRING, 0, "\"\"")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, locale, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_str_pad, 0, 0, 2)
+    ZEND_ARG_TYPE_INFO(0, text, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, width, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, pad, IS_STRING, 0, "\" \"")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, type, IS_LONG, 0, "STR_PAD_RIGHT")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, locale, IS_STRING, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_wrap, 0, 0, 2)
+    ZEND_ARG_TYPE_INFO(0, text, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO(0, columns, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, locale, IS_STRING, 1, "null")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, offsets, _IS_BOOL, 0, "false")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iter_stream, 0, 0, 1)
+    ZEND_ARG_INFO(0, stream)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, flags, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, chunk_size, IS_LONG, 0, "65536")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iter_file, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, filename, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, flags, IS_LONG, 0, "0")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_stats, 0, 0, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, reset, _IS_BOOL, 0, "false")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_stream_iterator_construct, 0, 0, 1)
+    ZEND_ARG_INFO(0, stream)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, flags, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, chunkSize, IS_LONG, 0, "65536")
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_construct, 0, 0, 1)
     ZEND_ARG_TYPE_INFO(0, text, IS_STRING, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, flags, IS_LONG, 0, "0")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, mode, IS_LONG, 0, "ICU4C_BREAK_GRAPHEME")
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, locale, IS_STRING, 1, "null")
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_current, 0, 0, 0)
@@ -71,9 +404,15 @@ ZEND_END_ARG_INFO()
 ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_next, 0, 0, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_prev, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_rewind, 0, 0, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_last, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_valid, 0, 0, 0)
 ZEND_END_ARG_INFO()
 
@@ -83,31 +422,159 @@ ZEND_END_ARG_INFO()
 ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_count, 0, 0, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_boundaries, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_packedboundaries, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_offsetexists, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_offsetget, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_offsetset, 0, 0, 2)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+    ZEND_ARG_TYPE_INFO(0, value, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_offsetunset, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_seek, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, offset, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_icu4c_iterator_slice, 0, 0, 1)
+    ZEND_ARG_TYPE_INFO(0, start, IS_LONG, 0)
+    ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, length, IS_LONG, 1, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_icu4c_iterator_serialize, 0, 0, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_icu4c_iterator_unserialize, 0, 1, IS_VOID, 0)
+    ZEND_ARG_TYPE_INFO(0, data, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
 PHP_MINIT_FUNCTION(icu4c);
 PHP_MSHUTDOWN_FUNCTION(icu4c);
+PHP_RSHUTDOWN_FUNCTION(icu4c);
 PHP_MINFO_FUNCTION(icu4c);
+PHP_GINIT_FUNCTION(icu4c);
+PHP_GSHUTDOWN_FUNCTION(icu4c);
 
 // ICU4CIterator class method declarations
 PHP_METHOD(ICU4CIterator, __construct);
 PHP_METHOD(ICU4CIterator, current);
 PHP_METHOD(ICU4CIterator, key);
 PHP_METHOD(ICU4CIterator, next);
+PHP_METHOD(ICU4CIterator, prev);
+PHP_METHOD(ICU4CIterator, last);
 PHP_METHOD(ICU4CIterator, rewind);
 PHP_METHOD(ICU4CIterator, valid);
 PHP_METHOD(ICU4CIterator, getIterator);
 PHP_METHOD(ICU4CIterator, count);
+PHP_METHOD(ICU4CIterator, boundaries);
+PHP_METHOD(ICU4CIterator, packedBoundaries);
+PHP_METHOD(ICU4CIterator, offsetExists);
+PHP_METHOD(ICU4CIterator, offsetGet);
+PHP_METHOD(ICU4CIterator, offsetSet);
+PHP_METHOD(ICU4CIterator, offsetUnset);
+PHP_METHOD(ICU4CIterator, seek);
+PHP_METHOD(ICU4CIterator, slice);
+PHP_METHOD(ICU4CIterator, __serialize);
+PHP_METHOD(ICU4CIterator, __unserialize);
+PHP_METHOD(ICU4CStreamIterator, __construct);
+PHP_METHOD(ICU4CStreamIterator, current);
+PHP_METHOD(ICU4CStreamIterator, key);
+PHP_METHOD(ICU4CStreamIterator, next);
+PHP_METHOD(ICU4CStreamIterator, rewind);
+PHP_METHOD(ICU4CStreamIterator, valid);
 
 // Internal utility functions
-#ifdef HAVE_ICU4C
+void icu4c_break_cursor_open(icu4c_break_cursor *cursor, const char *text, size_t text_len, UBreakIteratorType type, const char *locale);
+int32_t icu4c_break_cursor_next(icu4c_break_cursor *cursor);
+void icu4c_break_cursor_last(icu4c_break_cursor *cursor);
+int32_t icu4c_break_cursor_previous(icu4c_break_cursor *cursor);
+void icu4c_break_cursor_close(icu4c_break_cursor *cursor);
 size_t icu4c_count_grapheme_clusters(const char *text, size_t text_len, int32_t **boundaries);
-zend_string *icu4c_get_cluster_at_position(const char *text, size_t text_len, const int32_t *boundaries, size_t cluster_index);
-UChar32 icu4c_get_first_codepoint(const char *str, size_t len);
-int icu4c_calculate_display_width(UEastAsianWidth eaw, zend_string *locale);
+size_t icu4c_grapheme_len(const char *text, size_t text_len, size_t limit);
+
+// Parallel grapheme segmentation (icu4c_parallel.c)
+#define ICU4C_PARALLEL_MAX_THREADS    64
+typedef void (*icu4c_parallel_emit)(void *ctx, int32_t boundary);
+bool icu4c_parallel_segment(const char *text, size_t len, icu4c_parallel_emit emit, void *ctx);
+#ifdef HAVE_ICU4C
+UBreakIterator *icu4c_break_iter_acquire(UBreakIteratorType type, const char *locale, UErrorCode *status);
+void icu4c_break_iter_release(UBreakIterator *bi);
 bool icu4c_is_east_asian_locale(const char *locale);
+
+// East Asian Width table (icu4c_width.c)
+extern uint16_t *icu4c_width_index;
+extern uint8_t *icu4c_width_blocks;
+void icu4c_width_table_init(void);
+void icu4c_width_table_shutdown(void);
+size_t icu4c_string_width(const char *text, size_t text_len, bool east_asian);
+
+int icu4c_first_cluster_width(const char *text, size_t text_len, bool east_asian);
+
+// Width table entries: the UEastAsianWidth class in the low bits, and
+// flags for the cluster-level width rules above it
+#define ICU4C_WIDTH_EAW_MASK            0x07
+#define ICU4C_WIDTH_ZERO                0x08  // Mn, Me or Default_Ignorable_Code_Point
+#define ICU4C_WIDTH_EMOJI_PRESENTATION  0x10  // Emoji_Presentation
+#define ICU4C_WIDTH_EMOJI_BASE          0x20  // Emoji or Extended_Pictographic (wide before VS16)
+#define ICU4C_WIDTH_REGIONAL            0x40  // Regional_Indicator
+
+// Width table entry of a code point
+static inline uint8_t icu4c_width_props(UChar32 codepoint)
+{
+    return icu4c_width_blocks[((uint32_t)icu4c_width_index[codepoint >> 8] << 8) | (codepoint & 0xFF)];
+}
+
+// Display width of an East Asian Width class
+static inline int icu4c_eaw_to_width(UEastAsianWidth eaw, bool east_asian)
+{
+    switch (eaw) {
+        case U_EA_FULLWIDTH:  // [F] 全角
+        case U_EA_WIDE:       // [W] 広い
+            return 2;
+        
+        case U_EA_AMBIGUOUS:  // [A] 曖昧（コンテキスト依存）
+            return east_asian ? 2 : 1;  // 東アジア系ロケールでは全角扱い
+        
+        case U_EA_HALFWIDTH:  // [H] 半角
+        case U_EA_NARROW:     // [Na] 狭い
+        case U_EA_NEUTRAL:    // [N] 中立
+        default:
+            return 1;
+    }
+}
 #endif
 
 // ICU4CIterator class initialization
 void icu4c_iterator_init(void);
 zend_object *icu4c_iterator_create_object(zend_class_entry *ce);
+bool icu4c_iterator_check_args(zend_long flags, zend_long mode, uint32_t arg_num);
+void icu4c_iterator_setup(icu4c_iterator_obj *obj, zend_string *text, zend_long flags, zend_long mode, zend_string *locale);
+
+// Segmentation cache (icu4c_cache.c)
+void icu4c_boundary_index_release(icu4c_boundary_index *index);
+icu4c_boundary_index *icu4c_segment_cache_fetch(zend_string *text, zend_long mode, bool words_only, zend_string *locale);
+void icu4c_segment_cache_store(icu4c_boundary_index *index);
+icu4c_boundary_index *icu4c_shared_index_fetch(zend_string *text, zend_long mode, bool words_only, zend_string *locale);
+void icu4c_shared_index_store(icu4c_boundary_index *index);
+void icu4c_segment_cache_clear(icu4c_segment_cache *cache);
+
+// ICU4CStreamIterator class initialization (icu4c_stream.c)
+void icu4c_stream_iterator_init(void);
+bool icu4c_stream_iterator_check_args(zend_long flags, zend_long chunk_size, uint32_t arg_num);
+void icu4c_stream_iterator_setup(icu4c_stream_iterator_obj *obj, zval *stream, zend_long flags, zend_long chunk_size);
+bool icu4c_stream_iterator_open_file(icu4c_stream_iterator_obj *obj, zend_string *filename, zend_long flags);
 
 #endif /* PHP_ICU4C_H */
\ No newline at end of file
@@ -88,5 +88,265 @@ echo "getIterator() returns: " . get_class($internal_iter) . "\n";
 echo "Is same object: " . ($internal_iter === $iter7 ? "yes" : "no") . "\n";
 echo "\n";
 
+// Test 8: Bulk segmentation with icu4c_graphemes
+echo "Test 8: Bulk segmentation with icu4c_graphemes\n";
+$texts8 = ["Hello", "café", "葛\u{E0101}飾区", "", "a\r\nb", "👨‍👩‍👧‍👦!"];
+foreach ($texts8 as $text8) {
+    $clusters = icu4c_graphemes($text8);
+    $same = $clusters === iterator_to_array(icu4c_iter($text8));
+    echo "Text: '" . addcslashes($text8, "\r\n") . "' -> " . count($clusters) . " clusters, matches iterator: " . ($same ? "yes" : "no") . "\n";
+}
+echo "\n";
+
+// Test 9: Offsets without copying text
+echo "Test 9: Offsets without copying text\n";
+$text9 = "aé葛\u{E0101}👍🏽";
+$iter9 = icu4c_iter($text9, ICU4C_ITER_OFFSETS);
+echo "Text: '$text9'\n";
+foreach ($iter9 as $i => [$start, $length]) {
+    echo "[$i] start=$start length=$length '" . substr($text9, $start, $length) . "'\n";
+}
+echo "Boundaries: " . implode(",", $iter9->boundaries()) . "\n";
+echo "Packed matches: " . (array_values(unpack('l*', $iter9->packedBoundaries())) === $iter9->boundaries() ? "yes" : "no") . "\n";
+echo "\n";
+
+// Test 10: Word, line and sentence modes
+echo "Test 10: Word, line and sentence modes\n";
+$text10 = "Hello, 世界 world! Bye.";
+echo "Text: '$text10'\n";
+$modes = [
+    "word" => icu4c_iter($text10, 0, ICU4C_BREAK_WORD),
+    "word (skip non-words)" => icu4c_iter($text10, ICU4C_ITER_SKIP_NONWORDS, ICU4C_BREAK_WORD),
+    "line" => icu4c_iter($text10, 0, ICU4C_BREAK_LINE),
+    "sentence" => new ICU4CIterator($text10, 0, ICU4C_BREAK_SENTENCE),
+];
+foreach ($modes as $name => $iter10) {
+    echo "$name (" . count($iter10) . "): ";
+    foreach ($iter10 as $i => $segment) {
+        echo "[$i]='$segment' ";
+    }
+    echo "\n";
+}
+echo "\n";
+
+// Test 11: Explicit locale
+echo "Test 11: Explicit locale\n";
+$text11 = "สวัสดีครับ";
+foreach (["th", "en", null] as $locale11) {
+    $iter11 = icu4c_iter($text11, 0, ICU4C_BREAK_WORD, $locale11);
+    echo "locale " . var_export($locale11, true) . ": " . implode("|", iterator_to_array($iter11)) . "\n";
+}
+echo "\n";
+
+// Test 12: Streaming segmentation
+echo "Test 12: Streaming segmentation\n";
+$text12 = str_repeat("Ab葛\u{E0101}👨‍👩‍👧\r\n", 3);
+$stream12 = fopen("php://memory", "w+");
+fwrite($stream12, $text12);
+foreach ([3, 7, 65536] as $chunk12) {
+    rewind($stream12);
+    $clusters12 = iterator_to_array(icu4c_iter_stream($stream12, 0, $chunk12));
+    echo "chunk $chunk12: " . count($clusters12) . " clusters, " .
+        ($clusters12 === iterator_to_array(icu4c_iter($text12)) ? "matches" : "differs from") . " icu4c_iter()\n";
+}
+rewind($stream12);
+$offsets12 = [];
+foreach (new ICU4CStreamIterator($stream12, ICU4C_ITER_OFFSETS, 5) as [$start12, $length12]) {
+    $offsets12[] = "$start12:$length12";
+}
+echo "Offsets: " . implode(" ", array_slice($offsets12, 0, 6)) . "\n";
+fclose($stream12);
+echo "\n";
+
+// Test 13: Memory-mapped files
+echo "Test 13: Memory-mapped files\n";
+$file13 = tempnam(sys_get_temp_dir(), "icu4c");
+file_put_contents($file13, $text12);
+$clusters13 = iterator_to_array(icu4c_iter_file($file13));
+echo "Clusters: " . count($clusters13) . ", " .
+    ($clusters13 === iterator_to_array(icu4c_iter($text12)) ? "matches" : "differs from") . " icu4c_iter()\n";
+$last13 = null;
+foreach (icu4c_iter_file($file13, ICU4C_ITER_OFFSETS) as $last13);
+echo "Last offsets: " . implode(":", $last13) . " of " . filesize($file13) . " bytes\n";
+unlink($file13);
+echo "Missing file: " . var_export(@icu4c_iter_file($file13), true) . "\n";
+echo "\n";
+
+// Test 14: Long clusters in the compact boundary storage
+echo "Test 14: Long clusters\n";
+$text14 = "a" . str_repeat("\u{0301}", 200) . "b" . str_repeat("x", 300) . "c";
+$iter14 = icu4c_iter($text14, ICU4C_ITER_OFFSETS);
+$lengths14 = [];
+foreach ($iter14 as [$start14, $length14]) {
+    $lengths14[] = $length14;
+}
+echo "Count: " . count($iter14) . "\n";
+echo "First lengths: " . implode(" ", array_slice($lengths14, 0, 3)) . "\n";
+echo "Boundaries consistent: " . (array_values(unpack("l*", $iter14->packedBoundaries())) === $iter14->boundaries() ? "yes" : "no") . "\n";
+echo "\n";
+
+// Test 15: Random access and slicing
+echo "Test 15: Random access and slicing\n";
+$iter15 = icu4c_iter("葛\u{E0101}飾区👨‍👩‍👧abc");
+echo "\$iter[3]: '" . $iter15[3] . "'\n";
+echo "isset(\$iter[6]): " . var_export(isset($iter15[6]), true) . ", isset(\$iter[7]): " . var_export(isset($iter15[7]), true) . "\n";
+echo "slice(1, 3): '" . $iter15->slice(1, 3) . "'\n";
+echo "slice(-2): '" . $iter15->slice(-2) . "'\n";
+echo "slice(2, -1): '" . $iter15->slice(2, -1) . "'\n";
+$iter15->seek(4);
+echo "After seek(4): [" . $iter15->key() . "]='" . $iter15->current() . "'\n";
+try {
+    $iter15[0] = "x";
+} catch (Error $e) {
+    echo "Write: " . $e->getMessage() . "\n";
+}
+try {
+    $iter15->seek(100);
+} catch (OutOfBoundsException $e) {
+    echo "Seek: " . $e->getMessage() . "\n";
+}
+echo "\n";
+
+// Test 16: Instrumentation counters
+echo "Test 16: Instrumentation counters\n";
+icu4c_stats(true);
+$iter16 = icu4c_iter("Hello 世界");
+count($iter16);
+$stats16 = icu4c_stats(true);
+echo "Iterators created: " . $stats16['iterators_created'] . "\n";
+echo "Bytes segmented: " . $stats16['bytes_segmented'] . "\n";
+echo "Segments: " . $stats16['segments'] . "\n";
+echo "After reset: " . icu4c_stats()['segments'] . "\n";
+icu4c_graphemes("café au lait, crème brûlée");
+echo "Latin-1 cache misses: " . icu4c_stats(true)['break_iterator_cache_misses'] . "\n";
+echo "\n";
+
+// Test 17: Batch widths
+echo "Test 17: Batch widths\n";
+$widths17 = icu4c_eaw_widths(["id" => 42, "name" => "田中", "note" => "abc"]);
+echo "Per string: " . json_encode($widths17) . "\n";
+$columns17 = icu4c_eaw_widths([["ID", "名前"], ["1", "Alice"], ["100", "葛飾区"]], null, true);
+echo "Per column: " . json_encode($columns17) . "\n";
+try {
+    icu4c_eaw_widths(["a", "b"], null, true);
+} catch (TypeError $e) {
+    echo "Error: " . $e->getMessage() . "\n";
+}
+echo "\n";
+
+// Test 18: Segmentation cache
+echo "Test 18: Segmentation cache\n";
+ini_set('icu4c.segment_cache_size', '16');
+icu4c_stats(true);
+$text18 = str_repeat("Prod\u{00FA}ct n\u{0061}\u{0301}me 👍🏽 ", 3);
+foreach ([1, 2, 3] as $round) {
+    $clusters18 = iterator_to_array(icu4c_iter($text18));
+}
+$words18 = icu4c_iter($text18, ICU4C_ITER_SKIP_NONWORDS, ICU4C_BREAK_WORD);
+echo "Clusters: " . count($clusters18) . ", words: " . count($words18) . "\n";
+$stats18 = icu4c_stats(true);
+echo "Hits: " . $stats18['segment_cache_hits'] . ", misses: " . $stats18['segment_cache_misses'] . "\n";
+echo "\n";
+
+// Test 19: Shared boundaries
+echo "Test 19: Shared boundaries\n";
+icu4c_stats(true);
+$iter19 = icu4c_iter("Hello 世界 👍🏽");
+$iter19->next();
+$clone19 = clone $iter19;
+$clone19->next();
+echo "Positions: " . $iter19->key() . " " . $clone19->key() . "\n";
+echo "Current: " . $iter19->current() . "|" . $clone19->current() . "\n";
+foreach ([1, 2, 3] as $round) {
+    $count19 = count(icu4c_iter("Hello 世界 👍🏽"));
+}
+echo "Count: " . $count19 . ", clone count: " . count($clone19) . "\n";
+echo "Shared: " . icu4c_stats(true)['shared_index_hits'] . "\n";
+echo "\n";
+
+// Test 20: Count-only length
+echo "Test 20: Count-only length\n";
+echo "Length: " . icu4c_grapheme_len("Hello 👨‍👩‍👧‍👦 café") . "\n";
+echo "ASCII with CRLF: " . icu4c_grapheme_len("ab\r\ncd") . "\n";
+echo "Limited: " . icu4c_grapheme_len(str_repeat("葛󠄁", 1000), 10) . "\n";
+try {
+    icu4c_grapheme_len("abc", -1);
+} catch (ValueError $e) {
+    echo "Error: " . $e->getMessage() . "\n";
+}
+echo "\n";
+
+// Test 21: Parallel segmentation
+echo "Test 21: Parallel segmentation\n";
+$text21 = str_repeat("Hello 👨‍👩‍👧‍👦 café 🇯🇵 क्षत्रिय 한국어\r\n", 2000);
+$sequential21 = icu4c_graphemes($text21);
+ini_set('icu4c.parallel_threads', '4');
+ini_set('icu4c.parallel_min_size', '1024');
+$parallel21 = icu4c_graphemes($text21);
+$iter21 = icu4c_iter($text21);
+echo "Identical: " . ($sequential21 === $parallel21 ? "yes" : "no") . "\n";
+echo "Iterator count: " . (count($iter21) === count($sequential21) ? "matches" : "differs") . "\n";
+ini_restore('icu4c.parallel_threads');
+ini_restore('icu4c.parallel_min_size');
+echo "\n";
+
+// Test 22: Serialization
+echo "Test 22: Serialization\n";
+$iter22 = icu4c_iter("Hello 世界 👍🏽 ok", ICU4C_ITER_SKIP_NONWORDS, ICU4C_BREAK_WORD);
+$iter22->next();
+$data22 = serialize($iter22);
+icu4c_stats(true);
+$copy22 = unserialize($data22);
+echo "Position: " . $copy22->key() . ", current: " . $copy22->current() . "\n";
+echo "Words: " . implode("|", iterator_to_array($copy22)) . "\n";
+echo "Segmented again: " . icu4c_stats(true)['segments'] . "\n";
+$raw22 = $iter22->__serialize();
+$raw22['version'] = 'ICU 0.0';
+$stale22 = new ICU4CIterator("");
+$stale22->__unserialize($raw22);
+echo "Stale version: " . count($stale22) . " words, segmented again: " . (icu4c_stats()['segments'] > 0 ? "yes" : "no") . "\n";
+echo "\n";
+
+// Test 23: Line wrapping
+echo "Test 23: Line wrapping\n";
+echo "Words: " . implode("|", icu4c_wrap("The quick brown fox jumps over the lazy dog", 10)) . "\n";
+echo "Kinsoku: " . implode("|", icu4c_wrap("「こんにちは」、世界。", 6, "ja")) . "\n";
+echo "Hard breaks: " . implode("|", icu4c_wrap("one\r\n\ntwo three\n", 5)) . "\n";
+echo "Trailing spaces: " . json_encode(icu4c_wrap("abc\n   ", 10)) . ", " . json_encode(icu4c_wrap("   ", 10)) . "\n";
+echo "Long word: " . implode("|", icu4c_wrap("supercalifragilistic", 8)) . "\n";
+echo "Offsets: " . json_encode(icu4c_wrap("The quick brown fox", 10, null, true)) . "\n";
+try {
+    icu4c_wrap("abc", 0);
+} catch (ValueError $e) {
+    echo "Error: " . $e->getMessage() . "\n";
+}
+echo "\n";
+
+// Test 24: Reverse iteration
+echo "Test 24: Reverse iteration\n";
+icu4c_stats(true);
+$text24 = str_repeat("Lorem ipsum dolor sit amet. ", 1000) . "Tail 👍🏽 é";
+$tail24 = icu4c_iter($text24, ICU4C_ITER_REVERSE);
+echo "Last 6: " . $tail24->slice(0, 6) . "\n";
+echo "Reversed: " . implode("", iterator_to_array(icu4c_iter("Hello 👍🏽", ICU4C_ITER_REVERSE))) . "\n";
+echo "Segmented from the end: " . icu4c_stats(true)['segments'] . "\n";
+$words24 = icu4c_iter("one, two three", ICU4C_ITER_SKIP_NONWORDS | ICU4C_ITER_REVERSE, ICU4C_BREAK_WORD);
+echo "Words: " . implode("|", iterator_to_array($words24)) . ", count: " . count($words24) . "\n";
+$last24 = icu4c_iter($text24);
+icu4c_stats(true);
+$last24->last();
+$last24->prev();
+echo "Before last: " . $last24->current() . ", segmented: " . icu4c_stats(true)['segments'] . "\n";
+$iter24 = icu4c_iter("abc");
+$iter24->last();
+$walk24 = [];
+for (; $iter24->valid(); $iter24->prev()) {
+    $walk24[] = $iter24->key() . "=" . $iter24->current();
+}
+echo "Backward walk: " . implode(" ", $walk24) . ", key: " . $iter24->key() . "\n";
+$iter24->next();
+echo "After next: " . $iter24->current() . "\n";
+echo "\n";
+
 echo "All tests completed.\n";
 ?>
\ No newline at end of file
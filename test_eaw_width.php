@@ -165,5 +165,57 @@ foreach ($test_strings as $str) {
     echo "'{$str}' -> width: {$width_default}, width(ja): {$width_ja}\n";
 }
 
+echo "\n";
+
+// Test 15: Whole-string width with icu4c_str_width
+echo "Test 15: Whole-string width with icu4c_str_width\n";
+foreach ($test_strings as $str) {
+    $width_default = icu4c_str_width($str);
+    $width_ja = icu4c_str_width($str, 'ja');
+    $same = $width_default === icu4c_strwidth($str) && $width_ja === icu4c_strwidth($str, 'ja');
+    echo "'{$str}' -> width: {$width_default}, width(ja): {$width_ja}, matches loop: " . ($same ? "yes" : "no") . "\n";
+}
+echo "Empty string -> " . icu4c_str_width('') . "\n";
+
+echo "\n";
+
+// Test 16: Width-aware truncation and padding
+echo "Test 16: Width-aware truncation and padding\n";
+$cases = [
+    ["Hello世界", 6, "…"],
+    ["Hello世界", 9, "…"],
+    ["日本語テキスト", 7, "..."],
+    ["👨‍👩‍👧‍👦 family", 4, ""],
+];
+foreach ($cases as [$str, $width, $ellipsis]) {
+    $result = icu4c_str_truncate($str, $width, $ellipsis);
+    echo "truncate('{$str}', {$width}, '{$ellipsis}') -> '{$result}' (width " . icu4c_str_width($result) . ")\n";
+}
+foreach ([STR_PAD_RIGHT, STR_PAD_LEFT, STR_PAD_BOTH] as $type) {
+    $result = icu4c_str_pad("世界", 9, "・", $type, 'ja');
+    echo "pad('世界', 9, '・', {$type}, 'ja') -> '{$result}' (width(ja) " . icu4c_str_width($result, 'ja') . ")\n";
+}
+echo "pad('田中', 7) -> '" . icu4c_str_pad("田中", 7) . "|'\n";
+
+echo "\n";
+
+// Test 17: Cluster-level width (combining marks, emoji sequences, flags)
+echo "Test 17: Cluster-level width\n";
+$clusters = [
+    "e\u{0301}" => "e + combining acute",
+    "\u{0301}" => "lone combining acute",
+    "\u{200B}" => "zero width space",
+    "❤" => "heart (text default)",
+    "❤️" => "heart + VS16",
+    "#️⃣" => "keycap",
+    "👍🏿" => "thumbs up + skin tone",
+    "👨‍👩‍👧‍👦" => "ZWJ family",
+    "🇯🇵" => "flag",
+];
+foreach ($clusters as $cluster => $name) {
+    echo "{$name} -> " . icu4c_eaw_width($cluster) . "\n";
+}
+echo "icu4c_str_width('👨‍👩‍👧‍👦 e\u{0301}🇯🇵') -> " . icu4c_str_width("👨‍👩‍👧‍👦 e\u{0301}🇯🇵") . "\n";
+
 echo "\nAll tests completed.\n";
 ?>
\ No newline at end of file